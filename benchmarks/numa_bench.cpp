@@ -0,0 +1,161 @@
+// Benchmark of concurrent inference on a wide network with different parameter placements: regular pages with a
+// single copy, huge pages with a single copy, and huge pages with one replica per NUMA node. Reports throughput and
+// data TLB misses (when the kernel allows reading performance counters).
+//
+// Usage: numa_bench [threads] [width] [seconds]
+
+#include "bfloat16.h"
+#include "mlp.h"
+#include "numa_topology.h"
+#include "packed_model.h"
+#include "utils.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Counts data TLB read misses of the calling thread and every thread it spawns while enabled
+class TlbMissCounter {
+  public:
+    TlbMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~TlbMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+    TlbMissCounter(const TlbMissCounter &) = delete;
+    TlbMissCounter &operator=(const TlbMissCounter &) = delete;
+
+    [[nodiscard]] bool available() const noexcept { return fd >= 0; }
+
+    void start() const {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Only valid once all the spawned threads have exited, their counts are added to the parent at that point
+    [[nodiscard]] std::uint64_t stop() const {
+        std::uint64_t count = 0;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+
+  private:
+    int fd{-1};
+};
+
+const char *backingName(PageBacking backing) {
+    switch (backing) {
+    case PageBacking::Huge:
+        return "2MB pages";
+    case PageBacking::TransparentHuge:
+        return "transparent huge pages";
+    case PageBacking::Regular:
+        break;
+    }
+    return "4KB pages";
+}
+
+void runBenchmark(const std::string &name, const PackedModel &model, std::size_t numThreads, double seconds) {
+    const NumaTopology &topology = NumaTopology::system();
+    std::atomic<bool> running{true};
+    std::atomic<std::uint64_t> predictions{0};
+    std::vector<double> input(model.numInputs(), 0.5);
+
+    TlbMissCounter counter;
+    counter.start();
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            // Spread the load across every socket, like a server handling requests on all cores
+            topology.bindCurrentThreadToNode(t % topology.numNodes());
+            std::uint64_t local = 0;
+            while (running.load(std::memory_order_relaxed)) {
+                auto output = model.predict(input);
+                local += output.empty() ? 0 : 1;
+            }
+            predictions.fetch_add(local);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    running.store(false);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::uint64_t tlbMisses = counter.stop();
+
+    double throughput = static_cast<double>(predictions.load()) / elapsed;
+    std::cout << std::left << std::setw(40) << name << std::right << std::setw(12) << std::fixed
+              << std::setprecision(1) << throughput << " pred/s";
+    if (counter.available() && predictions.load() > 0) {
+        std::cout << std::setw(14) << std::setprecision(1)
+                  << static_cast<double>(tlbMisses) / static_cast<double>(predictions.load()) << " dTLB misses/pred";
+    } else {
+        std::cout << "   dTLB misses n/a";
+    }
+    std::cout << "  (" << backingName(model.pageBacking()) << ", " << model.numReplicas() << " replica"
+              << (model.numReplicas() == 1 ? "" : "s") << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t numThreads = argc > 1 ? std::stoul(argv[1]) : std::max(1U, std::thread::hardware_concurrency());
+    std::size_t width = argc > 2 ? std::stoul(argv[2]) : 1024;
+    double seconds = argc > 3 ? std::stod(argv[3]) : 2.0;
+
+    MLP mlp({width, width, width, width, 16}, 0.01, frelu, freluDerivative);
+    std::cout << "Network: " << width << "x" << width << " x3 layers, " << numThreads << " threads, "
+              << NumaTopology::system().numNodes() << " NUMA node(s)\n";
+
+    runBenchmark("regular pages, single copy", PackedModel(mlp, false, false), numThreads, seconds);
+    runBenchmark("huge pages, single copy", PackedModel(mlp, true, false), numThreads, seconds);
+    runBenchmark("huge pages, replica per node", PackedModel(mlp, true, true), numThreads, seconds);
+    runBenchmark("huge pages, replica per node, bfloat16", PackedModel(mlp, true, true, WeightPrecision::Bfloat16),
+                 numThreads, seconds);
+
+    return 0;
+}
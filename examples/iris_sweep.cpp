@@ -0,0 +1,85 @@
+// Example of a hyperparameter sweep on the Iris dataset, training several networks concurrently over the same data
+
+#include "sweep_trainer.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+int main() {
+    const std::string filename = "iris.csv";
+    std::ifstream file;
+    std::string dir;
+    try {
+        file.open(dir + filename);
+        if (!file.is_open()) {
+            dir = "build/";
+            file.open(dir + filename);
+            if (!file.is_open()) {
+                throw std::runtime_error("Could not find file: " + filename);
+            }
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Exception caught: " << e.what() << '\n';
+        return 1;
+    }
+
+    const std::unordered_map<std::string, double> conversionRules = {
+        {"Iris-setosa", 0.0}, {"Iris-versicolor", 1.0}, {"Iris-virginica", 2.0}};
+    std::vector<std::vector<double>> dataset = parseCSV(file, 0, {}, conversionRules);
+
+    // Same deterministic split as in the training example
+    std::mt19937 gen(42);
+    std::ranges::shuffle(dataset, gen);
+    auto trainingSize = static_cast<std::size_t>(0.8 * static_cast<double>(dataset.size()));
+
+    std::vector<std::vector<double>> trainingInputs;
+    std::vector<std::vector<double>> trainingTargets;
+    std::vector<std::vector<double>> validationInputs;
+    std::vector<std::vector<double>> validationTargets;
+    for (std::size_t i = 0; i < dataset.size(); ++i) {
+        auto &inputs = i < trainingSize ? trainingInputs : validationInputs;
+        auto &targets = i < trainingSize ? trainingTargets : validationTargets;
+        inputs.emplace_back(dataset[i].begin(), dataset[i].begin() + 4);
+        targets.push_back(oneHotEncode(dataset[i].back(), 3));
+    }
+
+    // Sweep over the hidden layer width, the learning rate and the activation function
+    std::vector<SweepConfig> configs;
+    for (std::size_t width : {5, 10, 20}) {
+        for (double learningRate : {0.001, 0.0001}) {
+            for (const std::string activation : {"relu", "tanh"}) {
+                SweepConfig config;
+                config.layersNodes = {4, width, width, 3};
+                config.learningRate = learningRate;
+                config.activation = activation;
+                config.softmax = true;
+                config.seed = 42;
+                config.epochs = 1000;
+                configs.push_back(config);
+            }
+        }
+    }
+
+    SweepTrainer trainer(trainingInputs, trainingTargets, validationInputs, validationTargets);
+    std::vector<SweepResult> results = trainer.run(configs, std::max(1U, std::thread::hardware_concurrency()), true);
+
+    for (const auto &result : results) {
+        const SweepConfig &config = configs[result.configIndex];
+        std::cout << "width " << config.layersNodes[1] << ", learning rate " << config.learningRate << ", "
+                  << config.activation << ": loss " << result.validationLoss << ", accuracy "
+                  << result.validationAccuracy * 100 << "%\n";
+    }
+
+    MLP best = trainer.getBestModel();
+    best.save("iris_sweep_model.bin");
+
+    return 0;
+}
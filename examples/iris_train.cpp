@@ -52,13 +52,16 @@ int main() {
         trainingTargets.push_back(oneHotEncode(row.back(), 3));    // Last element is the label
     }
 
-    MLP mlp(0.00001, true); // use softmax
+    MLP mlp(0.005, true); // use softmax
     mlp.addLayer(4, frelu, freluDerivative);
     mlp.addLayer(10, frelu, freluDerivative);
     mlp.addLayer(10, frelu, freluDerivative);
     mlp.addLayer(3, fidentity, fidentityDerivative);
 
-    mlp.train(trainingInputs, trainingTargets, 10000);
+    // Standardized features let the network converge with a much larger learning rate in far fewer epochs, the
+    // statistics are saved with the model so predict keeps taking the raw measurements
+    mlp.fitPreprocessor(trainingInputs, std::vector<FeatureTransform>(4, FeatureTransform::Standardize));
+    mlp.train(trainingInputs, trainingTargets, 500);
 
     // Validate the network
     std::vector<std::vector<int>> confusionMatrix(3, std::vector<int>(3, 0));
@@ -0,0 +1,68 @@
+#ifndef ASYNC_PREDICTOR_H
+#define ASYNC_PREDICTOR_H
+
+#include "mlp.h"
+#include "packed_model.h"
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Asynchronous inference for coroutine-based code. Awaiting asyncPredict suspends the coroutine and queues the
+// request, a few executor threads owned by the predictor take all the queued requests at once, evaluate them as a
+// single batch and resume every waiting coroutine with its result. Coroutines are resumed on the executor threads.
+class AsyncPredictor {
+  public:
+    class Awaitable {
+      public:
+        Awaitable(AsyncPredictor &predictor, std::vector<double> input);
+
+        Awaitable(const Awaitable &) = delete;
+        Awaitable &operator=(const Awaitable &) = delete;
+        Awaitable(Awaitable &&) = delete;
+        Awaitable &operator=(Awaitable &&) = delete;
+        ~Awaitable() = default;
+
+        [[nodiscard]] bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        std::vector<double> await_resume();
+
+      private:
+        friend class AsyncPredictor;
+
+        AsyncPredictor &predictor;
+        std::vector<double> input{};
+        std::vector<double> output{};
+        std::exception_ptr error{nullptr};
+        std::coroutine_handle<> continuation{nullptr};
+    };
+
+    explicit AsyncPredictor(const MLP &mlp, std::size_t numThreads = 1, std::size_t maxBatchSize = 64);
+    ~AsyncPredictor();
+
+    AsyncPredictor(const AsyncPredictor &) = delete;
+    AsyncPredictor &operator=(const AsyncPredictor &) = delete;
+    AsyncPredictor(AsyncPredictor &&) = delete;
+    AsyncPredictor &operator=(AsyncPredictor &&) = delete;
+
+    [[nodiscard]] Awaitable asyncPredict(std::vector<double> input);
+
+  private:
+    void enqueue(Awaitable &request);
+    void workerLoop();
+    void runBatch(std::vector<Awaitable *> &batch);
+
+    PackedModel model;
+    std::size_t maxBatchSize{64};
+    std::mutex mutex{};
+    std::condition_variable wakeup{};
+    std::deque<Awaitable *> queue{};
+    bool stopping{false};
+    std::vector<std::thread> workers{};
+};
+
+#endif // ASYNC_PREDICTOR_H
@@ -0,0 +1,39 @@
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#include "packed_model.h"
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+
+// Picks the fastest kernel configuration of a PackedModel for a batch size by timing candidates on the host. Decisions
+// are kept in a text cache file keyed by the CPU model, the layer sizes, the batch size and the weight precision, so
+// later runs on the same kind of machine start tuned without measuring anything. A batch split across threads goes
+// through the thread pool of the model, which runs one batch at a time, so models predicting from several threads at
+// once should be tuned with their number of concurrent callers to keep each batch on its caller's thread.
+class Autotuner {
+  public:
+    explicit Autotuner(std::string cachePath,
+                       std::chrono::milliseconds timePerCandidate = std::chrono::milliseconds{20});
+
+    KernelConfig tune(PackedModel &model, std::size_t batchSize, std::size_t concurrentCallers = 1);
+    [[nodiscard]] std::optional<KernelConfig> lookup(const PackedModel &model, std::size_t batchSize,
+                                                     std::size_t concurrentCallers = 1) const;
+
+    [[nodiscard]] static std::string cpuModel();
+
+  private:
+    [[nodiscard]] static std::string key(const PackedModel &model, std::size_t batchSize,
+                                         std::size_t concurrentCallers);
+    [[nodiscard]] double measure(PackedModel &model, std::size_t batchSize, const KernelConfig &config) const;
+    void load();
+    void save() const;
+
+    std::string cachePath;
+    std::chrono::milliseconds timePerCandidate{20};
+    std::map<std::string, KernelConfig> entries{};
+};
+
+#endif // AUTOTUNER_H
@@ -0,0 +1,23 @@
+#ifndef BFLOAT16_H
+#define BFLOAT16_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// Precision of the weights in a model file or a packed model. bfloat16 keeps the exponent range of a float with an 8
+// bit mantissa, so trained weights can be stored in a quarter of the space of a double without any calibration.
+enum class WeightPrecision : std::uint8_t { Double = 0, Bfloat16 = 1 };
+
+std::uint16_t toBfloat16(double value) noexcept;
+float fromBfloat16(std::uint16_t value) noexcept;
+
+// Dot product of a row of bfloat16 weights with float inputs, accumulated in float
+float dotBfloat16(const std::uint16_t *weights, const float *inputs, std::size_t count) noexcept;
+
+// Weights of a model file in the given precision, converted from and to the doubles used everywhere else
+void writeWeights(std::ofstream &out, const std::vector<double> &weights, WeightPrecision precision);
+void readWeights(std::ifstream &in, std::vector<double> &weights, WeightPrecision precision);
+
+#endif // BFLOAT16_H
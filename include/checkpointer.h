@@ -0,0 +1,52 @@
+#ifndef CHECKPOINTER_H
+#define CHECKPOINTER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes training checkpoints from a background thread so training never waits for the disk. Each checkpoint is
+// written to a temporary file, flushed with fsync and renamed over the previous one, so the file on disk is always
+// either the old or the new checkpoint even if the process is killed halfway.
+class Checkpointer {
+  public:
+    explicit Checkpointer(std::string path);
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer &) = delete;
+    Checkpointer &operator=(const Checkpointer &) = delete;
+    Checkpointer(Checkpointer &&) = delete;
+    Checkpointer &operator=(Checkpointer &&) = delete;
+
+    void submit(std::size_t epoch, std::vector<double> parameters);
+    void flush();
+
+    static bool load(const std::string &path, std::size_t expectedParameters, std::size_t &epoch,
+                     std::vector<double> &parameters);
+
+  private:
+    struct Snapshot {
+        std::size_t epoch{0};
+        std::vector<double> parameters{};
+    };
+
+    void writerLoop();
+    void write(const Snapshot &snapshot) const;
+    void rethrowError();
+
+    std::string path;
+    std::mutex mutex{};
+    std::condition_variable changed{};
+    std::optional<Snapshot> pending{};
+    bool writing{false};
+    bool stopping{false};
+    std::exception_ptr error{nullptr};
+    std::thread writer{};
+};
+
+#endif // CHECKPOINTER_H
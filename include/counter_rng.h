@@ -0,0 +1,31 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Streams of a seed at or above this one are used to shuffle the training samples, one per epoch, the ones below
+// initialize weights, one per neuron
+constexpr std::uint64_t kShuffleStream = std::uint64_t{1} << 63;
+// Streams from this one up to kShuffleStream initialize embedding tables, one per row
+constexpr std::uint64_t kEmbeddingStream = std::uint64_t{1} << 62;
+
+// Counter-based random number generator (Philox4x32-10). The n-th number of a stream is computed directly from the
+// seed, the stream id and n, with no state carried between draws, so any part of a model can be initialized
+// independently on any thread and still get exactly the same numbers.
+class CounterRng {
+  public:
+    CounterRng(std::uint64_t seed, std::uint64_t stream) noexcept;
+
+    [[nodiscard]] std::uint64_t operator()(std::uint64_t index) const noexcept;
+    [[nodiscard]] double uniform(std::uint64_t index) const noexcept;
+
+    void shuffle(std::vector<std::size_t> &indices) const noexcept;
+
+  private:
+    std::uint64_t seed{0};
+    std::uint64_t stream{0};
+};
+
+#endif // COUNTER_RNG_H
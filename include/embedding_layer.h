@@ -0,0 +1,53 @@
+#ifndef EMBEDDING_LAYER_H
+#define EMBEDDING_LAYER_H
+
+#include "bfloat16.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// Input of a network with embeddings: one category id per categorical column, followed by the numeric features
+struct CategoricalSample {
+    std::vector<std::uint32_t> categories{};
+    std::vector<double> features{};
+};
+
+// Learned vectors for the categories of a few categorical columns, one row of dimension values per category. The rows
+// of all the columns are stored back to back in a single table, a sample gathers one row per column and training only
+// updates those rows.
+class EmbeddingLayer {
+  public:
+    EmbeddingLayer() = default;
+    EmbeddingLayer(std::vector<std::size_t> cardinalities, std::size_t dimension, std::uint64_t seed);
+
+    [[nodiscard]] bool empty() const noexcept;
+    [[nodiscard]] std::size_t numColumns() const noexcept;
+    [[nodiscard]] std::size_t dimension() const noexcept;
+    [[nodiscard]] std::size_t outputSize() const noexcept;
+    [[nodiscard]] const std::vector<std::size_t> &getCardinalities() const noexcept;
+    [[nodiscard]] const std::vector<double> &getTable() const noexcept;
+    [[nodiscard]] std::vector<double> getRow(std::size_t column, std::uint32_t category) const;
+
+    void setTable(const std::vector<double> &newTable);
+
+    void validate(const std::vector<std::uint32_t> &categories) const;
+    void gather(const std::vector<std::uint32_t> &categories, double *output) const;
+    void update(const std::vector<std::uint32_t> &categories, const double *gradients, double learningRate);
+
+    void save(std::ofstream &out, WeightPrecision precision = WeightPrecision::Double) const;
+    void load(std::ifstream &in);
+
+  private:
+    // Sizes the table without filling it, for load to read it from the file
+    EmbeddingLayer(std::vector<std::size_t> cardinalities, std::size_t dimension);
+
+    [[nodiscard]] std::size_t rowOffset(std::size_t column, std::uint32_t category) const noexcept;
+
+    std::vector<std::size_t> cardinalities{};
+    std::vector<std::size_t> firstRows{}; // row of the table where the categories of each column start
+    std::size_t rowSize{0};
+    std::vector<double> table{};
+};
+
+#endif // EMBEDDING_LAYER_H
@@ -0,0 +1,36 @@
+#ifndef HUGE_PAGE_BUFFER_H
+#define HUGE_PAGE_BUFFER_H
+
+#include <cstddef>
+
+enum class PageBacking { Regular, TransparentHuge, Huge };
+
+// Fixed-size, zero-initialized array of doubles mapped directly from the kernel. When huge pages are requested it is
+// backed by 2MB pages if the system has them reserved, or advised for transparent huge pages otherwise, so that a
+// whole model is covered by a handful of TLB entries.
+class HugePageBuffer {
+  public:
+    HugePageBuffer() = default;
+    explicit HugePageBuffer(std::size_t count, bool hugePages = true);
+    ~HugePageBuffer();
+
+    HugePageBuffer(const HugePageBuffer &) = delete;
+    HugePageBuffer &operator=(const HugePageBuffer &) = delete;
+    HugePageBuffer(HugePageBuffer &&other) noexcept;
+    HugePageBuffer &operator=(HugePageBuffer &&other) noexcept;
+
+    [[nodiscard]] double *data() noexcept;
+    [[nodiscard]] const double *data() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] PageBacking backing() const noexcept;
+
+  private:
+    void release() noexcept;
+
+    void *memory{nullptr};
+    std::size_t bytes{0};
+    std::size_t count{0};
+    PageBacking pageBacking{PageBacking::Regular};
+};
+
+#endif // HUGE_PAGE_BUFFER_H
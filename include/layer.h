@@ -1,37 +1,80 @@
 #ifndef LAYER_H
 #define LAYER_H
 
+#include "bfloat16.h"
 #include "neuron.h"
+#include "sparse_vector.h"
+#include "thread_pool.h"
 #include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <functional>
 #include <vector>
 
+// How the weights of a layer are stored in a model file. Masked layers are pruned layers stored as all their weights
+// plus one bit per weight telling whether it was kept, which is smaller than sparse rows when few weights were pruned.
+enum class LayerEncoding : std::uint8_t {
+    Dense = 0,
+    Sparse = 1,
+    DenseBfloat16 = 2,
+    SparseBfloat16 = 3,
+    Masked = 4,
+    MaskedBfloat16 = 5
+};
+
 class Layer {
   public:
+    // Pruned layers at or below this fraction of nonzero weights are evaluated with the sparse kernel, above it the
+    // indirect input accesses cost more than the skipped multiply-adds
+    static constexpr double kSparseDensityBreakEven = 0.3;
+
     explicit Layer(size_t size, size_t inputsPerNeuron, std::function<double(double)> activationFunc,
                    std::function<double(double)> derivActivationFunc, bool normalize = false,
                    bool constantWeightInit = false);
 
     [[nodiscard]] std::vector<Neuron> &getNeurons() noexcept;
+    [[nodiscard]] const std::vector<Neuron> &getNeurons() const noexcept;
+    [[nodiscard]] const std::function<double(double)> &getActivationFunction() const noexcept;
+    [[nodiscard]] bool isNormalized() const noexcept;
+    [[nodiscard]] bool isPruned() const noexcept;
+    [[nodiscard]] bool isSparse() const noexcept;
+    [[nodiscard]] double getDensity() const;
     std::vector<double> getOutputs() const;
     double getActivationResult(double output) const;
     double getDerivActivationResult(double output) const;
 
     void setAllWeights(const std::vector<std::vector<double>> &newWeights);
-    void setInputsForAllNeurons(const std::vector<double> &inputs);
+    void setInputsForAllNeurons(const std::vector<double> &inputs, ThreadPool *pool = nullptr);
     void setOutputs(const std::vector<double> &outputs);
 
+    void initializeWeights(std::size_t numInputs, std::uint64_t seed, std::size_t layerIndex,
+                           ThreadPool *pool = nullptr);
     void connectLayer(Layer &previousLayer);
-    void calculateOutputs();
+    void connectLayer(Layer &previousLayer, std::uint64_t seed, std::size_t layerIndex, ThreadPool *pool = nullptr);
+    void calculateOutputs(ThreadPool *pool = nullptr);
+    void calculateSparseOutputs(const std::vector<double> &inputs, ThreadPool *pool = nullptr);
+    void feedForward(const std::vector<double> &inputs, ThreadPool *pool = nullptr);
+    void feedForward(const SparseVector &inputs, ThreadPool *pool = nullptr);
+    void updateWeights(const SparseVector &inputs, double learningRate);
     void applySoftmax();
 
-    void save(std::ofstream &out) const;
-    void load(std::ifstream &in);
+    std::size_t prune(double threshold);
+    void applyPruningMask();
+
+    void save(std::ofstream &out, WeightPrecision precision = WeightPrecision::Double) const;
+    void load(std::ifstream &in, bool legacyFormat = false);
 
   private:
+    void buildSparseStructure();
+    void clearPruning() noexcept;
+
     bool normalize{false};
+    bool pruned{false};
     std::vector<Neuron> neurons{};
+    // Compressed sparse rows of the weights that survived pruning, one row per neuron
+    std::vector<std::size_t> rowStart{};
+    std::vector<std::uint32_t> columns{};
+    std::vector<double> values{};
     std::function<double(double)> activationFunction{nullptr};
     std::function<double(double)> derivActivationFunction{nullptr};
 };
@@ -1,44 +1,106 @@
 #ifndef MLP_H
 #define MLP_H
 
+#include "bfloat16.h"
+#include "embedding_layer.h"
 #include "layer.h"
+#include "preprocessor.h"
+#include "sparse_vector.h"
+#include "thread_pool.h"
+#include "transport.h"
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 class MLP {
   public:
+    // Minimum number of multiply-adds in a layer (neurons * inputs) to be worth splitting across threads
+    static constexpr std::size_t kDefaultMinLayerWork = 1 << 16;
+
     MLP(const std::vector<size_t> &layersNodes, double lr, const std::function<double(double)> &activationFunc,
         const std::function<double(double)> &derivActivationFunc, const bool softmax = false,
-        const bool constantWeightInit = false);
+        const bool constantWeightInit = false, std::size_t numThreads = 1);
 
     explicit MLP(double lr);
     explicit MLP(double lr, const bool softmax);
 
     [[nodiscard]] std::vector<double> getResult() const;
     std::vector<Layer> &getLayers() noexcept;
+    [[nodiscard]] const std::vector<Layer> &getLayers() const noexcept;
+    [[nodiscard]] bool usesSoftmax() const noexcept;
+    [[nodiscard]] std::uint64_t getSeed() const noexcept;
+    [[nodiscard]] const Preprocessor &getPreprocessor() const noexcept;
+    [[nodiscard]] const EmbeddingLayer &getEmbeddings() const noexcept;
+    [[nodiscard]] std::size_t getNumParameters() const noexcept;
+    [[nodiscard]] std::vector<double> getParameters() const;
 
     void setWeightsAllLayers(const std::vector<std::vector<std::vector<double>>> &newWeights);
+    void setParameters(const std::vector<double> &parameters);
+    void setParallelism(std::size_t numThreads, std::size_t minLayerWork = kDefaultMinLayerWork);
+    void setShuffle(bool shuffle) noexcept;
+    void fitPreprocessor(const std::vector<std::vector<double>> &inputData,
+                         const std::vector<FeatureTransform> &transforms);
+    void setEmbeddings(const std::vector<std::size_t> &cardinalities, std::size_t dimension);
 
     void addLayer(size_t numNodes, const std::function<double(double)> &activationFunc,
                   const std::function<double(double)> &derivActivationFunc, const bool normalize = false,
                   const bool constantWeightInit = false);
+    void initializeWeights(std::uint64_t seed);
     void feedForward(const std::vector<double> &inputValues);
+    void feedForward(const SparseVector &inputValues);
+    void feedForward(const CategoricalSample &sample);
     void backPropagate(const std::vector<double> &targetValues);
 
+    void prune(double sparsity, bool perLayer = false);
+
+    void train(const std::vector<std::vector<double>> &inputData, const std::vector<std::vector<double>> &targetData,
+               std::size_t epochs);
     void train(const std::vector<std::vector<double>> &inputData, const std::vector<std::vector<double>> &targetData,
+               std::size_t epochs, const std::string &checkpointPath, std::size_t checkpointInterval = 1);
+    void train(const std::vector<std::vector<double>> &inputData, const std::vector<std::vector<double>> &targetData,
+               std::size_t epochs, Transport &transport, std::size_t syncsPerEpoch = 1);
+    void train(const std::vector<SparseVector> &inputData, const std::vector<std::vector<double>> &targetData,
+               std::size_t epochs);
+    void train(const std::vector<CategoricalSample> &inputData, const std::vector<std::vector<double>> &targetData,
                std::size_t epochs);
 
     std::vector<double> predict(const std::vector<double> &input);
+    std::vector<double> predict(const SparseVector &input);
+    std::vector<double> predict(const CategoricalSample &input);
 
-    void save(const std::string &filename);
+    void save(const std::string &filename, WeightPrecision precision = WeightPrecision::Double);
     void load(const std::string &filename);
 
+    void exportHeader(const std::string &filename, const std::string &modelName) const;
+
   private:
+    void orderSamples(std::size_t numSamples, std::size_t epoch);
+    void trainEpoch(const std::vector<std::vector<double>> &inputData,
+                    const std::vector<std::vector<double>> &targetData, std::size_t epoch);
+
     double learningRate{0.01};
     std::vector<Layer> layers{};
     bool softmax{false};
+    std::shared_ptr<ThreadPool> threadPool{nullptr};
+    std::size_t minLayerWork{kDefaultMinLayerWork};
+    // Weights and the order of the samples in each epoch are drawn from this seed
+    std::uint64_t seed{0};
+    bool shuffle{false};
+    // Applied to the inputs by train and predict, but not by feedForward
+    Preprocessor preprocessor{};
+    std::vector<std::size_t> sampleOrder{};
+    // Set by the sparse feedForward, backPropagate then only updates the first layer's weights of the nonzero inputs
+    bool sparseInputActive{false};
+    SparseVector sparseInput{};
+    // Fill the first inputs of the network, set by the categorical feedForward to be updated by backPropagate
+    EmbeddingLayer embeddings{};
+    bool embeddingInputActive{false};
+    std::vector<std::uint32_t> embeddingCategories{};
+    std::vector<double> embeddedInput{};
+    std::vector<double> embeddingGradients{};
 };
 
 #endif // MLP_H
@@ -1,7 +1,9 @@
 #ifndef NEURON_H
 #define NEURON_H
 
+#include "sparse_vector.h"
 #include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <functional>
 #include <vector>
@@ -13,6 +15,7 @@ class Neuron {
 
     double getOutput() const noexcept;
     double getGradient() const noexcept;
+    double getBias() const noexcept;
     const std::vector<double> &getWeights() const noexcept;
     const std::vector<double> &getInputs() const noexcept;
 
@@ -22,7 +25,13 @@ class Neuron {
     void setGradient(double newGradient);
 
     void initializeWeights(size_t numInputs);
+    void initializeWeights(size_t numInputs, std::uint64_t seed, std::uint64_t stream);
     double calculatePreOutput();
+    [[nodiscard]] double calculatePreOutput(const SparseVector &sparseInputs) const;
+    void updateWeights(const SparseVector &sparseInputs, double step);
+    void maskWeights(const std::uint32_t *keptColumns, std::size_t numKept, double *keptValues) noexcept;
+    void maskWeights(const SparseVector &touched, const std::uint32_t *keptColumns, std::size_t numKept,
+                     double *keptValues) noexcept;
 
     void save(std::ofstream &out) const;
     void load(std::ifstream &in);
@@ -0,0 +1,28 @@
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// NUMA nodes of the host and the CPUs that belong to each of them, read from sysfs. Hosts without NUMA information
+// are described as a single node containing every CPU.
+class NumaTopology {
+  public:
+    explicit NumaTopology(const std::string &sysfsNodeDir = "/sys/devices/system/node");
+
+    static const NumaTopology &system();
+
+    [[nodiscard]] std::size_t numNodes() const noexcept;
+    [[nodiscard]] const std::vector<unsigned> &cpusOfNode(std::size_t node) const;
+    [[nodiscard]] std::size_t nodeOfCpu(unsigned cpu) const noexcept;
+    [[nodiscard]] std::size_t currentNode() const noexcept;
+
+    bool bindCurrentThreadToNode(std::size_t node) const;
+
+  private:
+    std::vector<std::vector<unsigned>> nodeCpus{};
+    std::vector<std::size_t> cpuNodes{};
+};
+
+#endif // NUMA_TOPOLOGY_H
@@ -0,0 +1,55 @@
+#ifndef ONLINE_LEARNER_H
+#define ONLINE_LEARNER_H
+
+#include "bfloat16.h"
+#include "mlp.h"
+#include "packed_model.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Keeps serving a model while it is fine-tuned on new samples. Updates are applied to a private MLP, and every
+// publishInterval updates it is packed into a new immutable snapshot that replaces the served one with a single atomic
+// store. Readers only load the current snapshot, so they never wait for training and never see a half-updated model.
+// Updates from several threads are serialized with each other, but not with the readers.
+class OnlineLearner {
+  public:
+    struct Snapshot {
+        std::uint64_t version{0};
+        PackedModel model;
+    };
+
+    explicit OnlineLearner(MLP mlp, std::size_t publishInterval = 1,
+                           WeightPrecision precision = WeightPrecision::Double);
+
+    [[nodiscard]] std::shared_ptr<const Snapshot> current() const noexcept;
+    [[nodiscard]] std::uint64_t version() const noexcept;
+    [[nodiscard]] std::vector<double> predict(const std::vector<double> &input) const;
+
+    void update(const std::vector<double> &input, const std::vector<double> &target);
+    void update(const std::vector<std::vector<double>> &inputData,
+                const std::vector<std::vector<double>> &targetData);
+    void publish();
+
+    void save(const std::string &filename, WeightPrecision savePrecision = WeightPrecision::Double);
+
+  private:
+    void train(const std::vector<double> &input, const std::vector<double> &target);
+    void publishLocked();
+
+    MLP mlp;
+    std::size_t publishInterval{1};
+    WeightPrecision precision{WeightPrecision::Double};
+    std::mutex updateMutex{};
+    std::size_t pendingUpdates{0};
+    std::uint64_t nextVersion{1};
+    std::atomic<std::shared_ptr<const Snapshot>> served{};
+    // Replaced snapshots are freed here once no reader holds them, so readers never pay for releasing a model
+    std::vector<std::shared_ptr<const Snapshot>> retired{};
+};
+
+#endif // ONLINE_LEARNER_H
@@ -0,0 +1,77 @@
+#ifndef PACKED_MODEL_H
+#define PACKED_MODEL_H
+
+#include "bfloat16.h"
+#include "huge_page_buffer.h"
+#include "mlp.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Blocking and threading of the batched kernels of a PackedModel, any choice gives the same results
+struct KernelConfig {
+    std::size_t sampleTile{0}; // samples evaluated together through all the layers, 0 for the whole batch
+    std::size_t rowBlock{1};   // rows of weights accumulated at once in the double precision kernel, 1, 2, 4 or 8
+    std::size_t numThreads{1}; // threads a batch is split across, including the caller
+
+    bool operator==(const KernelConfig &) const = default;
+};
+
+// Read-only snapshot of a trained MLP for serving. All the parameters are packed into one contiguous buffer (optionally
+// on huge pages) and, on NUMA hosts, replicated once per node so every thread reads the copy in its local memory.
+// predict is const and can be called concurrently from any number of threads. With bfloat16 precision the weights take
+// a quarter of the memory traffic, and the layers are evaluated in float. The preprocessing of the MLP is folded into
+// the first layer.
+class PackedModel {
+  public:
+    explicit PackedModel(const MLP &mlp, bool hugePages = true, bool replicatePerNode = true,
+                         WeightPrecision precision = WeightPrecision::Double);
+
+    [[nodiscard]] std::size_t numInputs() const noexcept;
+    [[nodiscard]] std::size_t numOutputs() const noexcept;
+    [[nodiscard]] std::size_t numParameters() const noexcept;
+    [[nodiscard]] std::size_t numReplicas() const noexcept;
+    [[nodiscard]] PageBacking pageBacking() const noexcept;
+    [[nodiscard]] WeightPrecision weightPrecision() const noexcept;
+    [[nodiscard]] std::vector<std::size_t> layerSizes() const;
+    [[nodiscard]] const KernelConfig &kernelConfig() const noexcept;
+
+    void setKernelConfig(const KernelConfig &config);
+
+    [[nodiscard]] std::vector<double> predict(const std::vector<double> &input) const;
+    [[nodiscard]] std::vector<std::vector<double>> predictBatch(const std::vector<std::vector<double>> &batch) const;
+
+  private:
+    struct PackedLayer {
+        std::size_t inputs{0};
+        std::size_t outputs{0};
+        std::size_t weightsOffset{0}; // row-major outputs x inputs, in weights of the model's precision
+        std::size_t biasOffset{0};
+        std::function<double(double)> activationFunction{nullptr};
+    };
+
+    [[nodiscard]] const HugePageBuffer &localReplica() const noexcept;
+    template <typename T>
+    void predictTile(const std::vector<std::vector<double>> &batch, std::size_t begin, std::size_t end,
+                     std::vector<std::vector<double>> &outputs) const;
+    void forwardDouble(std::vector<double> &current, std::vector<double> &next, std::size_t batchSize) const;
+    void forwardBfloat16(std::vector<float> &current, std::vector<float> &next, std::size_t batchSize) const;
+    template <typename T> void applyLogFeatures(T *sample) const;
+    void applySoftmax(std::vector<double> &output) const;
+
+    std::vector<PackedLayer> layers{};
+    std::vector<HugePageBuffer> replicas{};
+    std::vector<std::size_t> logFeatures{};
+    std::size_t inputs{0};
+    std::size_t parameters{0};
+    std::size_t weightsBase{0}; // the biases of all the layers come first, then the weights
+    std::size_t maxWidth{0};
+    bool softmax{false};
+    WeightPrecision precision{WeightPrecision::Double};
+    KernelConfig config{};
+    std::shared_ptr<ThreadPool> threadPool{nullptr};
+};
+
+#endif // PACKED_MODEL_H
@@ -0,0 +1,43 @@
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// How a single input feature is rescaled before entering the network. Log standardizes log(1 + x), for features with
+// a long tail, negative values are clamped to zero first.
+enum class FeatureTransform : std::uint8_t { None = 0, Standardize = 1, MinMax = 2, Log = 3 };
+
+// Per-feature transforms fitted on the training data. Every transform ends with an affine step x * scale + offset,
+// which can be folded into the weights of the first layer, only the logarithm has to be computed at inference.
+class Preprocessor {
+  public:
+    Preprocessor() = default;
+
+    [[nodiscard]] bool empty() const noexcept;
+    [[nodiscard]] std::size_t numFeatures() const noexcept;
+    [[nodiscard]] const std::vector<FeatureTransform> &getTransforms() const noexcept;
+    [[nodiscard]] const std::vector<double> &getScales() const noexcept;
+    [[nodiscard]] const std::vector<double> &getOffsets() const noexcept;
+
+    void fit(const std::vector<std::vector<double>> &data, const std::vector<FeatureTransform> &transforms,
+             ThreadPool *pool = nullptr);
+
+    [[nodiscard]] std::vector<double> transform(const std::vector<double> &input) const;
+    [[nodiscard]] std::vector<std::vector<double>> transform(const std::vector<std::vector<double>> &data) const;
+    [[nodiscard]] double applyNonAffine(std::size_t feature, double value) const;
+    void foldInto(std::vector<double> &weights, double &bias) const;
+
+    void save(std::ofstream &out) const;
+    void load(std::ifstream &in);
+
+  private:
+    std::vector<FeatureTransform> transforms{};
+    std::vector<double> scales{};
+    std::vector<double> offsets{};
+};
+
+#endif // PREPROCESSOR_H
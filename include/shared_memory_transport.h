@@ -0,0 +1,51 @@
+#ifndef SHARED_MEMORY_TRANSPORT_H
+#define SHARED_MEMORY_TRANSPORT_H
+
+#include "transport.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Transport between processes of the same machine through a POSIX shared memory segment. Every rank owns a small
+// ring of slots the next rank reads from, and sleeps on a futex when it can make no progress. All the ranks of a job
+// open the segment by the same name, which must be unique to the job, and it is unlinked as soon as all of them have
+// attached, so nothing is left behind even if a worker crashes.
+class SharedMemoryTransport : public Transport {
+  public:
+    // Doubles per slot, larger messages are split
+    static constexpr std::size_t kDefaultSlotCapacity = std::size_t{1} << 16;
+
+    // A timeout of zero waits for the other ranks forever
+    SharedMemoryTransport(const std::string &name, std::size_t rank, std::size_t size,
+                          std::chrono::milliseconds timeout = std::chrono::milliseconds{0},
+                          std::size_t slotCapacity = kDefaultSlotCapacity);
+    ~SharedMemoryTransport() override;
+
+    SharedMemoryTransport(const SharedMemoryTransport &) = delete;
+    SharedMemoryTransport &operator=(const SharedMemoryTransport &) = delete;
+    SharedMemoryTransport(SharedMemoryTransport &&) = delete;
+    SharedMemoryTransport &operator=(SharedMemoryTransport &&) = delete;
+
+    [[nodiscard]] std::size_t rank() const noexcept override;
+    [[nodiscard]] std::size_t size() const noexcept override;
+
+    void exchange(const double *send, std::size_t sendCount, double *receive, std::size_t receiveCount) override;
+
+  private:
+    struct Mailbox;
+
+    [[nodiscard]] Mailbox &mailbox(std::size_t owner) const noexcept;
+    [[nodiscard]] double *slot(std::size_t owner, std::uint32_t piece) const noexcept;
+    void ring(std::size_t owner) const noexcept;
+    void waitFor(std::uint32_t &word, std::uint32_t seen, std::chrono::steady_clock::time_point lastProgress) const;
+
+    std::size_t workerRank{0};
+    std::size_t worldSize{1};
+    std::size_t slotCapacity{kDefaultSlotCapacity};
+    std::chrono::milliseconds timeout{0};
+    void *memory{nullptr};
+    std::size_t bytes{0};
+};
+
+#endif // SHARED_MEMORY_TRANSPORT_H
@@ -0,0 +1,21 @@
+#ifndef SPARSE_VECTOR_H
+#define SPARSE_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vector of length size that stores only its nonzero entries as index/value pairs, such as the concatenated one-hot
+// encodings of categorical features. Entries that are not stored are zero.
+struct SparseVector {
+    std::size_t size{0};
+    std::vector<std::uint32_t> indices{};
+    std::vector<double> values{};
+
+    [[nodiscard]] static SparseVector fromDense(const std::vector<double> &dense);
+    [[nodiscard]] std::size_t nonZeros() const noexcept;
+    [[nodiscard]] std::vector<double> toDense() const;
+    void append(const SparseVector &other);
+};
+
+#endif // SPARSE_VECTOR_H
@@ -0,0 +1,37 @@
+#ifndef SPIN_WAIT_H
+#define SPIN_WAIT_H
+
+#include <chrono>
+#include <thread>
+
+// How long a waiting thread polls before it parks, bounded by time since the cost of a pause varies a lot between CPUs
+constexpr std::chrono::microseconds kSpinDuration{5};
+// Polls between clock reads, so reading the clock stays cheap next to the pauses
+constexpr int kPollsPerClockRead = 16;
+
+// Hint to the CPU that the thread is busy-waiting
+inline void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Polls done until it returns true or kSpinDuration passes, returns whether it became true
+template <typename Condition> bool spinUntil(Condition done) {
+    auto deadline = std::chrono::steady_clock::now() + kSpinDuration;
+    while (true) {
+        for (int poll = 0; poll < kPollsPerClockRead; ++poll) {
+            if (done()) {
+                return true;
+            }
+            cpuRelax();
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return done();
+        }
+    }
+}
+
+#endif // SPIN_WAIT_H
@@ -0,0 +1,55 @@
+#ifndef SWEEP_TRAINER_H
+#define SWEEP_TRAINER_H
+
+#include "mlp.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Hyperparameters of one model of a sweep, activations are given by the names used in utils.h
+struct SweepConfig {
+    std::vector<std::size_t> layersNodes{};
+    double learningRate{0.01};
+    std::string activation{"relu"};
+    std::string outputActivation{"identity"};
+    bool softmax{false};
+    unsigned seed{0};
+    std::size_t epochs{100};
+};
+
+struct SweepResult {
+    std::size_t configIndex{0};
+    double validationLoss{0.0};     // mean squared error
+    double validationAccuracy{0.0}; // fraction of samples whose largest output matches the largest target
+};
+
+// Trains many independently configured models in one process over a single copy of the dataset. The models are
+// scheduled on a work-stealing pool, so a few slow configurations do not leave the other threads idle.
+class SweepTrainer {
+  public:
+    SweepTrainer(const std::vector<std::vector<double>> &trainingInputs,
+                 const std::vector<std::vector<double>> &trainingTargets,
+                 const std::vector<std::vector<double>> &validationInputs,
+                 const std::vector<std::vector<double>> &validationTargets);
+
+    std::vector<SweepResult> run(const std::vector<SweepConfig> &configs, std::size_t numThreads,
+                                 bool interleaveSameShape = false);
+
+    [[nodiscard]] const MLP &getModel(std::size_t configIndex) const;
+    [[nodiscard]] const MLP &getBestModel() const;
+
+  private:
+    void trainGroup(const std::vector<std::size_t> &group, const std::vector<SweepConfig> &configs);
+    [[nodiscard]] SweepResult validate(std::size_t configIndex);
+
+    // The dataset is shared by every model and never copied, it must outlive the trainer
+    const std::vector<std::vector<double>> &trainingInputs;
+    const std::vector<std::vector<double>> &trainingTargets;
+    const std::vector<std::vector<double>> &validationInputs;
+    const std::vector<std::vector<double>> &validationTargets;
+
+    std::vector<MLP> models{};
+    std::size_t bestIndex{0};
+};
+
+#endif // SWEEP_TRAINER_H
@@ -0,0 +1,44 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads used to split a loop across cores with very low dispatch latency. Idle workers
+// spin for a short while before parking, so back-to-back calls (e.g. one per layer) do not pay for a wake-up.
+class ThreadPool {
+  public:
+    explicit ThreadPool(std::size_t numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    void parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)> &task);
+
+  private:
+    void workerLoop(std::size_t part);
+    void runPart(std::size_t part) noexcept;
+
+    std::vector<std::thread> workers{};
+    std::mutex submitMutex{};
+    std::mutex errorMutex{};
+    std::exception_ptr error{nullptr};
+    const std::function<void(std::size_t, std::size_t)> *job{nullptr};
+    std::size_t jobCount{0};
+    std::atomic<std::uint32_t> generation{0};
+    std::atomic<std::uint32_t> pending{0};
+    std::atomic<bool> stopping{false};
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,29 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <cstddef>
+#include <vector>
+
+// Connection of one worker to the others of a data-parallel job, arranged in a ring. Implementations only need to
+// move doubles to the next worker while receiving from the previous one, the collectives are built on top of that.
+class Transport {
+  public:
+    Transport() = default;
+    virtual ~Transport() = default;
+
+    Transport(const Transport &) = delete;
+    Transport &operator=(const Transport &) = delete;
+    Transport(Transport &&) = delete;
+    Transport &operator=(Transport &&) = delete;
+
+    [[nodiscard]] virtual std::size_t rank() const noexcept = 0;
+    [[nodiscard]] virtual std::size_t size() const noexcept = 0;
+
+    // Send sendCount values to the next rank and receive receiveCount values from the previous one, returning once
+    // both are done. Every rank calls it at the same time, so it must not wait for the send to finish before receiving.
+    virtual void exchange(const double *send, std::size_t sendCount, double *receive, std::size_t receiveCount) = 0;
+};
+
+void ringAllReduce(Transport &transport, std::vector<double> &values);
+
+#endif // TRANSPORT_H
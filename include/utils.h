@@ -1,8 +1,14 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include "sparse_vector.h"
+#include <cstddef>
+#include <fstream>
+#include <functional>
 #include <random>
+#include <string>
 #include <unordered_map>
+#include <utility>
 
 bool approxEqual(double a, double b, double epsilon = 1e-5);
 double fsigmoid(double x);
@@ -13,7 +19,11 @@ double frelu(double x);
 double freluDerivative(double x);
 double fidentity(double x);
 double fidentityDerivative(double x);
+std::string activationName(const std::function<double(double)> &activationFunc);
+std::pair<double (*)(double), double (*)(double)> activationByName(const std::string &name);
 std::vector<double> oneHotEncode(double value, int categories);
+SparseVector oneHotEncodeSparse(double value, int categories);
+std::size_t remainingBytes(std::ifstream &in);
 std::vector<std::vector<double>> parseCSV(std::ifstream &file, int skipHeaderLines, const std::vector<int> &skipColumns,
                                           const std::unordered_map<std::string, double> &conversionRules);
 
@@ -0,0 +1,115 @@
+#include "async_predictor.h"
+#include "mlp.h"
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <format>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+AsyncPredictor::Awaitable::Awaitable(AsyncPredictor &predictor, std::vector<double> input)
+    : predictor(predictor), input(std::move(input)) {}
+
+bool AsyncPredictor::Awaitable::await_ready() const noexcept { return false; }
+
+void AsyncPredictor::Awaitable::await_suspend(std::coroutine_handle<> handle) {
+    continuation = handle;
+    predictor.enqueue(*this);
+}
+
+std::vector<double> AsyncPredictor::Awaitable::await_resume() {
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return std::move(output);
+}
+
+AsyncPredictor::AsyncPredictor(const MLP &mlp, std::size_t numThreads, std::size_t maxBatchSize)
+    : model(mlp), maxBatchSize(std::max<std::size_t>(1, maxBatchSize)) {
+    workers.reserve(std::max<std::size_t>(1, numThreads));
+    for (std::size_t i = 0; i < std::max<std::size_t>(1, numThreads); ++i) {
+        workers.emplace_back(&AsyncPredictor::workerLoop, this);
+    }
+}
+
+// Requests that are still queued are completed before the executor threads exit
+AsyncPredictor::~AsyncPredictor() {
+    {
+        std::scoped_lock lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+// The returned object must be awaited right away, it refers to this predictor and holds the request while suspended
+AsyncPredictor::Awaitable AsyncPredictor::asyncPredict(std::vector<double> input) { return {*this, std::move(input)}; }
+
+void AsyncPredictor::enqueue(Awaitable &request) {
+    {
+        std::scoped_lock lock(mutex);
+        if (stopping) {
+            throw std::logic_error("Predictions cannot be requested while the predictor is being destroyed");
+        }
+        queue.push_back(&request);
+    }
+    wakeup.notify_one();
+}
+
+void AsyncPredictor::workerLoop() {
+    std::vector<Awaitable *> batch;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wakeup.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            // Take everything that arrived while the previous batch was running, up to the batch size
+            std::size_t batchSize = std::min(queue.size(), maxBatchSize);
+            batch.assign(queue.begin(), queue.begin() + static_cast<std::ptrdiff_t>(batchSize));
+            queue.erase(queue.begin(), queue.begin() + static_cast<std::ptrdiff_t>(batchSize));
+            if (!queue.empty()) {
+                wakeup.notify_one();
+            }
+        }
+        runBatch(batch);
+    }
+}
+
+void AsyncPredictor::runBatch(std::vector<Awaitable *> &batch) {
+    // Malformed requests fail on their own instead of failing the whole batch
+    std::vector<Awaitable *> valid;
+    std::vector<std::vector<double>> inputs;
+    for (Awaitable *request : batch) {
+        if (request->input.size() != model.numInputs()) {
+            request->error = std::make_exception_ptr(
+                std::invalid_argument(std::format("Mismatch in number of inputs provided, expected {}, got {}",
+                                                  model.numInputs(), request->input.size())));
+            continue;
+        }
+        valid.push_back(request);
+        inputs.push_back(std::move(request->input));
+    }
+
+    try {
+        std::vector<std::vector<double>> outputs = model.predictBatch(inputs);
+        for (std::size_t i = 0; i < valid.size(); ++i) {
+            valid[i]->output = std::move(outputs[i]);
+        }
+    } catch (...) {
+        for (Awaitable *request : valid) {
+            request->error = std::current_exception();
+        }
+    }
+
+    // Resuming may destroy the awaitable together with its coroutine frame, so it is the last access to each request
+    for (Awaitable *request : batch) {
+        request->continuation.resume();
+    }
+}
@@ -0,0 +1,197 @@
+#include "autotuner.h"
+#include "bfloat16.h"
+#include "packed_model.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Calls timed per candidate at least, whatever the time budget
+constexpr std::size_t kMinRuns = 3;
+
+// Best time among a few candidates, each built from the best configuration found so far
+template <typename Apply, typename Measure>
+void searchDimension(KernelConfig &best, double &bestTime, const std::vector<std::size_t> &values, Apply apply,
+                     Measure measure) {
+    for (std::size_t value : values) {
+        KernelConfig candidate = best;
+        apply(candidate, value);
+        if (candidate == best) {
+            continue;
+        }
+        double time = measure(candidate);
+        if (time < bestTime) {
+            best = candidate;
+            bestTime = time;
+        }
+    }
+}
+
+// Whether a cached configuration can be used on this machine, the file may come from another one or be hand edited
+bool isUsable(const KernelConfig &config) {
+    bool validRowBlock = config.rowBlock == 1 || config.rowBlock == 2 || config.rowBlock == 4 || config.rowBlock == 8;
+    unsigned maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    return validRowBlock && config.numThreads >= 1 && config.numThreads <= maxThreads;
+}
+
+} // namespace
+
+Autotuner::Autotuner(std::string cachePath, std::chrono::milliseconds timePerCandidate)
+    : cachePath(std::move(cachePath)), timePerCandidate(timePerCandidate) {
+    load();
+}
+
+// Model name of the first CPU as reported by the kernel, the same string on every machine of a given kind
+std::string Autotuner::cpuModel() {
+    std::ifstream cpuInfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuInfo, line)) {
+        if (line.starts_with("model name")) {
+            std::size_t colon = line.find(':');
+            std::size_t first = line.find_first_not_of(" \t", colon + 1);
+            return first == std::string::npos ? "unknown" : line.substr(first);
+        }
+    }
+    return "unknown";
+}
+
+// Configurations for concurrent callers are kept apart, with an extra field so the single-caller keys stay unchanged
+std::string Autotuner::key(const PackedModel &model, std::size_t batchSize, std::size_t concurrentCallers) {
+    std::ostringstream shape;
+    for (std::size_t size : model.layerSizes()) {
+        shape << (shape.tellp() == 0 ? "" : "-") << size;
+    }
+    return cpuModel() + '\t' + shape.str() + '\t' + std::to_string(batchSize) + '\t' +
+           (model.weightPrecision() == WeightPrecision::Bfloat16 ? "bfloat16" : "double") +
+           (concurrentCallers > 1 ? "\tconcurrent" : "");
+}
+
+std::optional<KernelConfig> Autotuner::lookup(const PackedModel &model, std::size_t batchSize,
+                                              std::size_t concurrentCallers) const {
+    auto entry = entries.find(key(model, batchSize, concurrentCallers));
+    if (entry == entries.end()) {
+        return std::nullopt;
+    }
+    return entry->second;
+}
+
+// Set the fastest configuration for batches of batchSize samples on the model and return it. Only a cache miss is
+// measured, one dimension at a time: the thread count first, since it matters most, then the sample tile and the row
+// block. The other predictions of the model must wait until tuning is done. The timings only see a single caller, and
+// the batches of concurrent callers would queue up for the thread pool, so with several of them every batch stays on
+// one thread.
+KernelConfig Autotuner::tune(PackedModel &model, std::size_t batchSize, std::size_t concurrentCallers) {
+    if (batchSize == 0) {
+        throw std::invalid_argument("Batch size must be at least 1.");
+    }
+    if (concurrentCallers == 0) {
+        throw std::invalid_argument("A model must have at least 1 caller.");
+    }
+    if (std::optional<KernelConfig> cached = lookup(model, batchSize, concurrentCallers)) {
+        model.setKernelConfig(*cached);
+        return *cached;
+    }
+
+    std::vector<std::size_t> threadCounts;
+    if (concurrentCallers == 1) {
+        std::size_t maxThreads = std::min<std::size_t>(std::max(1U, std::thread::hardware_concurrency()), batchSize);
+        for (std::size_t threads = 2; threads < maxThreads; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(maxThreads);
+    }
+    std::vector<std::size_t> sampleTiles{0};
+    for (std::size_t tile = 4; tile < batchSize; tile *= 4) {
+        sampleTiles.push_back(tile);
+    }
+    // The bfloat16 kernel is already vectorized along the inputs and has no row blocking
+    std::vector<std::size_t> rowBlocks{1};
+    if (model.weightPrecision() == WeightPrecision::Double) {
+        rowBlocks = {2, 4, 8};
+    }
+
+    auto measureCandidate = [&](const KernelConfig &config) { return measure(model, batchSize, config); };
+    KernelConfig best{};
+    double bestTime = measureCandidate(best);
+    searchDimension(best, bestTime, threadCounts, [](KernelConfig &c, std::size_t v) { c.numThreads = v; },
+                    measureCandidate);
+    searchDimension(best, bestTime, sampleTiles, [](KernelConfig &c, std::size_t v) { c.sampleTile = v; },
+                    measureCandidate);
+    searchDimension(best, bestTime, rowBlocks, [](KernelConfig &c, std::size_t v) { c.rowBlock = v; },
+                    measureCandidate);
+
+    model.setKernelConfig(best);
+    entries[key(model, batchSize, concurrentCallers)] = best;
+    save();
+    return best;
+}
+
+// Shortest time of one batch, after a warm-up call that also sizes the per-thread buffers
+double Autotuner::measure(PackedModel &model, std::size_t batchSize, const KernelConfig &config) const {
+    model.setKernelConfig(config);
+    std::vector<std::vector<double>> batch(batchSize, std::vector<double>(model.numInputs()));
+    for (std::size_t b = 0; b < batchSize; ++b) {
+        for (std::size_t i = 0; i < batch[b].size(); ++i) {
+            batch[b][i] = static_cast<double>((b * 31 + i * 7) % 17) / 17.0 - 0.5;
+        }
+    }
+    static_cast<void>(model.predictBatch(batch));
+
+    using Clock = std::chrono::steady_clock;
+    double bestTime = std::numeric_limits<double>::infinity();
+    Clock::time_point deadline = Clock::now() + timePerCandidate;
+    for (std::size_t run = 0; run < kMinRuns || Clock::now() < deadline; ++run) {
+        Clock::time_point start = Clock::now();
+        static_cast<void>(model.predictBatch(batch));
+        bestTime = std::min(bestTime, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return bestTime;
+}
+
+// One entry per line, the tab-separated key followed by the sample tile, the row block and the thread count. Lines that
+// cannot be parsed or hold a configuration this machine cannot run are skipped, a missing file is an empty cache.
+void Autotuner::load() {
+    std::ifstream in(cachePath);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::size_t valueStart = line.rfind('\t');
+        if (valueStart == std::string::npos) {
+            continue;
+        }
+        std::istringstream value(line.substr(valueStart + 1));
+        KernelConfig config;
+        if (value >> config.sampleTile >> config.rowBlock >> config.numThreads && isUsable(config)) {
+            entries[line.substr(0, valueStart)] = config;
+        }
+    }
+}
+
+// The whole cache is rewritten and renamed over the previous file, so a concurrent reader never sees half of it
+void Autotuner::save() const {
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::trunc);
+        for (const auto &[entryKey, config] : entries) {
+            out << entryKey << '\t' << config.sampleTile << ' ' << config.rowBlock << ' ' << config.numThreads << '\n';
+        }
+        if (!out) {
+            throw std::runtime_error("Unable to write tuning cache " + temporaryPath);
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), "Unable to replace tuning cache " + cachePath);
+    }
+}
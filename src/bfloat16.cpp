@@ -0,0 +1,83 @@
+#include "bfloat16.h"
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+// Independent partial sums, enough to fill two 256 bit vectors of floats so the compiler can vectorize the loop without
+// reordering the additions itself
+constexpr std::size_t kLanes = 16;
+
+} // namespace
+
+// Round to the nearest bfloat16, ties to even, keeping NaNs as quiet NaNs. The double is first narrowed to a float
+// rounding to odd, which keeps a trace of the discarded bits in the last one, so rounding that float gives the same
+// result as rounding the double directly.
+std::uint16_t toBfloat16(double value) noexcept {
+    float narrowed = static_cast<float>(value);
+    if (std::isnan(value)) {
+        return static_cast<std::uint16_t>((std::bit_cast<std::uint32_t>(narrowed) >> 16) | 0x40);
+    }
+    if (static_cast<double>(narrowed) != value) {
+        if (std::abs(static_cast<double>(narrowed)) > std::abs(value)) {
+            narrowed = std::nextafter(narrowed, 0.0F);
+        }
+        narrowed = std::bit_cast<float>(std::bit_cast<std::uint32_t>(narrowed) | 1);
+    }
+    auto bits = std::bit_cast<std::uint32_t>(narrowed);
+    std::uint32_t roundingBias = 0x7FFF + ((bits >> 16) & 1);
+    return static_cast<std::uint16_t>((bits + roundingBias) >> 16);
+}
+
+float fromBfloat16(std::uint16_t value) noexcept {
+    return std::bit_cast<float>(static_cast<std::uint32_t>(value) << 16);
+}
+
+float dotBfloat16(const std::uint16_t *weights, const float *inputs, std::size_t count) noexcept {
+    std::array<float, kLanes> partial{};
+    std::size_t i = 0;
+    for (; i + kLanes <= count; i += kLanes) {
+        for (std::size_t lane = 0; lane < kLanes; ++lane) {
+            partial[lane] += fromBfloat16(weights[i + lane]) * inputs[i + lane];
+        }
+    }
+    for (; i < count; ++i) {
+        partial[i % kLanes] += fromBfloat16(weights[i]) * inputs[i];
+    }
+
+    float sum = 0.0F;
+    for (float value : partial) {
+        sum += value;
+    }
+    return sum;
+}
+
+void writeWeights(std::ofstream &out, const std::vector<double> &weights, WeightPrecision precision) {
+    if (precision == WeightPrecision::Double) {
+        out.write(reinterpret_cast<const char *>(weights.data()), sizeof(double) * weights.size());
+        return;
+    }
+    std::vector<std::uint16_t> converted(weights.size());
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        converted[i] = toBfloat16(weights[i]);
+    }
+    out.write(reinterpret_cast<const char *>(converted.data()), sizeof(std::uint16_t) * converted.size());
+}
+
+// weights must already have the number of values to read
+void readWeights(std::ifstream &in, std::vector<double> &weights, WeightPrecision precision) {
+    if (precision == WeightPrecision::Double) {
+        in.read(reinterpret_cast<char *>(weights.data()), sizeof(double) * weights.size());
+        return;
+    }
+    std::vector<std::uint16_t> converted(weights.size());
+    in.read(reinterpret_cast<char *>(converted.data()), sizeof(std::uint16_t) * converted.size());
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = fromBfloat16(converted[i]);
+    }
+}
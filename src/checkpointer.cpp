@@ -0,0 +1,182 @@
+#include "checkpointer.h"
+#include "utils.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::uint64_t kCheckpointMagic = 0x54504B43504C4D; // "MLPCKPT" when read as little endian bytes
+constexpr std::uint32_t kCheckpointVersion = 1;
+
+// Write the whole buffer, retrying on partial writes and interruptions
+void writeAll(int fd, const void *data, std::size_t size, const std::string &filename) {
+    const auto *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Unable to write checkpoint " + filename);
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+} // namespace
+
+Checkpointer::Checkpointer(std::string path) : path(std::move(path)), writer(&Checkpointer::writerLoop, this) {}
+
+// Whatever was submitted is still written before the checkpointer goes away
+Checkpointer::~Checkpointer() {
+    {
+        std::scoped_lock lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+}
+
+// Hand a snapshot to the background thread and return immediately. If the previous snapshot is still waiting to be
+// written it is replaced, only the newest state is worth persisting. Errors of earlier writes are rethrown here.
+void Checkpointer::submit(std::size_t epoch, std::vector<double> parameters) {
+    {
+        std::scoped_lock lock(mutex);
+        rethrowError();
+        pending = Snapshot{epoch, std::move(parameters)};
+    }
+    changed.notify_all();
+}
+
+// Block until every submitted snapshot is on disk
+void Checkpointer::flush() {
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [this]() { return (!pending && !writing) || error; });
+    rethrowError();
+}
+
+// Read a checkpoint written by this class, returns false if there is none at the given path. The parameter count is
+// checked against the expected one and the size of the file before anything is allocated from it.
+bool Checkpointer::load(const std::string &path, std::size_t expectedParameters, std::size_t &epoch,
+                        std::vector<double> &parameters) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::uint64_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint64_t savedEpoch = 0;
+    std::uint64_t numParameters = 0;
+    file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    file.read(reinterpret_cast<char *>(&savedEpoch), sizeof(savedEpoch));
+    file.read(reinterpret_cast<char *>(&numParameters), sizeof(numParameters));
+    if (!file || magic != kCheckpointMagic || version > kCheckpointVersion) {
+        throw std::runtime_error("Not a valid checkpoint file: " + path);
+    }
+    if (numParameters != expectedParameters) {
+        throw std::runtime_error(std::format("Checkpoint file {} has {} parameters, expected {}", path, numParameters,
+                                             expectedParameters));
+    }
+    if (numParameters > remainingBytes(file) / sizeof(double)) {
+        throw std::runtime_error("Truncated checkpoint file: " + path);
+    }
+    std::vector<double> savedParameters(numParameters);
+    file.read(reinterpret_cast<char *>(savedParameters.data()),
+              static_cast<std::streamsize>(sizeof(double) * numParameters));
+    if (!file) {
+        throw std::runtime_error("Truncated checkpoint file: " + path);
+    }
+    epoch = savedEpoch;
+    parameters = std::move(savedParameters);
+    return true;
+}
+
+void Checkpointer::writerLoop() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        changed.wait(lock, [this]() { return stopping || pending; });
+        if (!pending) {
+            return;
+        }
+        Snapshot snapshot = std::move(*pending);
+        pending.reset();
+        writing = true;
+
+        // Serialization and disk I/O happen without holding the lock, so submit never waits for them
+        lock.unlock();
+        std::exception_ptr writeError;
+        try {
+            write(snapshot);
+        } catch (...) {
+            writeError = std::current_exception();
+        }
+        lock.lock();
+
+        writing = false;
+        if (writeError && !error) {
+            error = writeError;
+        }
+        changed.notify_all();
+    }
+}
+
+void Checkpointer::write(const Snapshot &snapshot) const {
+    std::string temporaryPath = path + ".tmp";
+    int fd = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Unable to create checkpoint " + temporaryPath);
+    }
+    try {
+        std::uint64_t epoch = snapshot.epoch;
+        std::uint64_t numParameters = snapshot.parameters.size();
+        writeAll(fd, &kCheckpointMagic, sizeof(kCheckpointMagic), temporaryPath);
+        writeAll(fd, &kCheckpointVersion, sizeof(kCheckpointVersion), temporaryPath);
+        writeAll(fd, &epoch, sizeof(epoch), temporaryPath);
+        writeAll(fd, &numParameters, sizeof(numParameters), temporaryPath);
+        writeAll(fd, snapshot.parameters.data(), sizeof(double) * numParameters, temporaryPath);
+        if (::fsync(fd) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Unable to sync checkpoint " + temporaryPath);
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), "Unable to replace checkpoint " + path);
+    }
+
+    // Persist the rename itself, otherwise a crash could bring back the previous directory entry
+    std::filesystem::path directory = std::filesystem::absolute(path).parent_path();
+    int directoryFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directoryFd >= 0) {
+        ::fsync(directoryFd);
+        ::close(directoryFd);
+    }
+}
+
+// Must be called with the mutex held
+void Checkpointer::rethrowError() {
+    if (error) {
+        std::exception_ptr current = std::exchange(error, nullptr);
+        std::rethrow_exception(current);
+    }
+}
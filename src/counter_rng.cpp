@@ -0,0 +1,55 @@
+#include "counter_rng.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Multipliers and key increments from Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"
+constexpr std::uint32_t kPhiloxM0 = 0xD2511F53;
+constexpr std::uint32_t kPhiloxM1 = 0xCD9E8D57;
+constexpr std::uint32_t kPhiloxW0 = 0x9E3779B9;
+constexpr std::uint32_t kPhiloxW1 = 0xBB67AE85;
+constexpr int kPhiloxRounds = 10;
+
+std::array<std::uint32_t, 4> philox(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key) noexcept {
+    for (int round = 0; round < kPhiloxRounds; ++round) {
+        std::uint64_t product0 = static_cast<std::uint64_t>(kPhiloxM0) * counter[0];
+        std::uint64_t product1 = static_cast<std::uint64_t>(kPhiloxM1) * counter[2];
+        counter = {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                   static_cast<std::uint32_t>(product1),
+                   static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                   static_cast<std::uint32_t>(product0)};
+        key[0] += kPhiloxW0;
+        key[1] += kPhiloxW1;
+    }
+    return counter;
+}
+
+} // namespace
+
+CounterRng::CounterRng(std::uint64_t seed, std::uint64_t stream) noexcept : seed(seed), stream(stream) {}
+
+// 64 random bits for the index-th draw of the stream
+std::uint64_t CounterRng::operator()(std::uint64_t index) const noexcept {
+    auto result = philox({static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32),
+                          static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)},
+                         {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)});
+    return (static_cast<std::uint64_t>(result[0]) << 32) | result[1];
+}
+
+// Uniform double in [0, 1) built from the top 53 bits
+double CounterRng::uniform(std::uint64_t index) const noexcept {
+    return static_cast<double>((*this)(index) >> 11) * 0x1.0p-53;
+}
+
+// Fisher-Yates shuffle of an index permutation, the result only depends on the seed, the stream and the input order
+void CounterRng::shuffle(std::vector<std::size_t> &indices) const noexcept {
+    for (std::size_t i = indices.size(); i > 1; --i) {
+        // The modulo bias is below 2^-40 for any realistic dataset size
+        auto j = static_cast<std::size_t>((*this)(i) % i);
+        std::swap(indices[i - 1], indices[j]);
+    }
+}
@@ -0,0 +1,179 @@
+#include "embedding_layer.h"
+#include "bfloat16.h"
+#include "counter_rng.h"
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Number of values in the table, nothing when it does not fit in a size_t
+std::optional<std::size_t> tableSize(const std::vector<std::size_t> &cardinalities, std::size_t dimension) {
+    constexpr std::size_t maxSize = std::numeric_limits<std::size_t>::max();
+    std::size_t numRows = 0;
+    for (std::size_t cardinality : cardinalities) {
+        if (cardinality > maxSize - numRows) {
+            return std::nullopt;
+        }
+        numRows += cardinality;
+    }
+    if (dimension != 0 && numRows > maxSize / dimension) {
+        return std::nullopt;
+    }
+    return numRows * dimension;
+}
+
+} // namespace
+
+EmbeddingLayer::EmbeddingLayer(std::vector<std::size_t> cardinalities, std::size_t dimension)
+    : cardinalities(std::move(cardinalities)), rowSize(dimension) {
+    if (rowSize == 0 || std::ranges::find(this->cardinalities, 0) != this->cardinalities.end()) {
+        throw std::invalid_argument("Embeddings need a nonzero dimension and at least one category per column.");
+    }
+    std::optional<std::size_t> size = tableSize(this->cardinalities, rowSize);
+    if (!size) {
+        throw std::length_error("Embedding table too large");
+    }
+    std::size_t numRows = 0;
+    for (std::size_t cardinality : this->cardinalities) {
+        firstRows.push_back(numRows);
+        numRows += cardinality;
+    }
+    table.resize(*size);
+}
+
+// Rows are drawn uniformly from [-1, 1) / sqrt(dimension), each from its own stream of the seed
+EmbeddingLayer::EmbeddingLayer(std::vector<std::size_t> cardinalities, std::size_t dimension, std::uint64_t seed)
+    : EmbeddingLayer(std::move(cardinalities), dimension) {
+    std::size_t numRows = table.size() / rowSize;
+    double scale = 1.0 / std::sqrt(static_cast<double>(rowSize));
+    for (std::size_t row = 0; row < numRows; ++row) {
+        CounterRng rng(seed, kEmbeddingStream + row);
+        for (std::size_t i = 0; i < rowSize; ++i) {
+            table[row * rowSize + i] = (2.0 * rng.uniform(i) - 1.0) * scale;
+        }
+    }
+}
+
+bool EmbeddingLayer::empty() const noexcept { return cardinalities.empty(); }
+
+std::size_t EmbeddingLayer::numColumns() const noexcept { return cardinalities.size(); }
+
+std::size_t EmbeddingLayer::dimension() const noexcept { return rowSize; }
+
+// Number of inputs of the network taken by the embeddings, which come before the numeric features
+std::size_t EmbeddingLayer::outputSize() const noexcept { return cardinalities.size() * rowSize; }
+
+const std::vector<std::size_t> &EmbeddingLayer::getCardinalities() const noexcept { return cardinalities; }
+
+const std::vector<double> &EmbeddingLayer::getTable() const noexcept { return table; }
+
+std::vector<double> EmbeddingLayer::getRow(std::size_t column, std::uint32_t category) const {
+    if (column >= cardinalities.size() || category >= cardinalities[column]) {
+        throw std::out_of_range(std::format("No category {} in column {}", category, column));
+    }
+    auto first = table.begin() + static_cast<std::ptrdiff_t>(rowOffset(column, category));
+    return {first, first + static_cast<std::ptrdiff_t>(rowSize)};
+}
+
+void EmbeddingLayer::setTable(const std::vector<double> &newTable) {
+    if (newTable.size() != table.size()) {
+        throw std::invalid_argument(std::format("Mismatch in size of the embedding table, expected {}, got {}",
+                                                table.size(), newTable.size()));
+    }
+    table = newTable;
+}
+
+void EmbeddingLayer::validate(const std::vector<std::uint32_t> &categories) const {
+    if (categories.size() != cardinalities.size()) {
+        throw std::invalid_argument(std::format("Mismatch in number of categorical columns, expected {}, got {}",
+                                                cardinalities.size(), categories.size()));
+    }
+    for (std::size_t column = 0; column < categories.size(); ++column) {
+        if (categories[column] >= cardinalities[column]) {
+            throw std::out_of_range(std::format("Category {} out of range for column {} with {} categories",
+                                                categories[column], column, cardinalities[column]));
+        }
+    }
+}
+
+// Copy the row of each category to output, one after the other. The categories must have been validated.
+void EmbeddingLayer::gather(const std::vector<std::uint32_t> &categories, double *output) const {
+    for (std::size_t column = 0; column < categories.size(); ++column) {
+        const double *row = table.data() + rowOffset(column, categories[column]);
+        std::copy(row, row + rowSize, output + column * rowSize);
+    }
+}
+
+// Gradient step on the gathered rows only, given the gradients of the loss with respect to the gathered values
+void EmbeddingLayer::update(const std::vector<std::uint32_t> &categories, const double *gradients,
+                            double learningRate) {
+    for (std::size_t column = 0; column < categories.size(); ++column) {
+        double *row = table.data() + rowOffset(column, categories[column]);
+        const double *rowGradients = gradients + column * rowSize;
+        for (std::size_t i = 0; i < rowSize; ++i) {
+            row[i] -= learningRate * rowGradients[i];
+        }
+    }
+}
+
+std::size_t EmbeddingLayer::rowOffset(std::size_t column, std::uint32_t category) const noexcept {
+    return (firstRows[column] + category) * rowSize;
+}
+
+// A layer without columns is written as just a zero column count
+void EmbeddingLayer::save(std::ofstream &out, WeightPrecision precision) const {
+    std::size_t columns = cardinalities.size();
+    out.write(reinterpret_cast<const char *>(&columns), sizeof(columns));
+    if (columns == 0) {
+        return;
+    }
+    out.write(reinterpret_cast<const char *>(&rowSize), sizeof(rowSize));
+    out.write(reinterpret_cast<const char *>(cardinalities.data()), sizeof(std::size_t) * columns);
+    out.write(reinterpret_cast<const char *>(&precision), sizeof(precision));
+    writeWeights(out, table, precision);
+}
+
+// Sizes read from the file are checked against what is left of it before anything is allocated from them
+void EmbeddingLayer::load(std::ifstream &in) {
+    std::size_t columns = 0;
+    in.read(reinterpret_cast<char *>(&columns), sizeof(columns));
+    if (!in || columns > remainingBytes(in) / sizeof(std::size_t)) {
+        throw std::runtime_error("Corrupted embeddings in model file");
+    }
+    if (columns == 0) {
+        *this = EmbeddingLayer();
+        return;
+    }
+
+    std::size_t dimension = 0;
+    std::vector<std::size_t> loadedCardinalities(columns);
+    WeightPrecision precision = WeightPrecision::Double;
+    in.read(reinterpret_cast<char *>(&dimension), sizeof(dimension));
+    in.read(reinterpret_cast<char *>(loadedCardinalities.data()), sizeof(std::size_t) * columns);
+    in.read(reinterpret_cast<char *>(&precision), sizeof(precision));
+    if (!in || (precision != WeightPrecision::Double && precision != WeightPrecision::Bfloat16) || dimension == 0 ||
+        std::ranges::find(loadedCardinalities, 0) != loadedCardinalities.end()) {
+        throw std::runtime_error("Corrupted embeddings in model file");
+    }
+    std::optional<std::size_t> size = tableSize(loadedCardinalities, dimension);
+    std::size_t bytesPerWeight = precision == WeightPrecision::Double ? sizeof(double) : sizeof(std::uint16_t);
+    if (!size || *size > remainingBytes(in) / bytesPerWeight) {
+        throw std::runtime_error("Corrupted embeddings in model file");
+    }
+    EmbeddingLayer loaded(std::move(loadedCardinalities), dimension);
+    readWeights(in, loaded.table, precision);
+    if (!in) {
+        throw std::runtime_error("Corrupted embeddings in model file");
+    }
+    *this = std::move(loaded);
+}
@@ -0,0 +1,96 @@
+#include "huge_page_buffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+constexpr std::size_t kHugePageSize = std::size_t{2} * 1024 * 1024;
+
+std::size_t roundUp(std::size_t value, std::size_t multiple) { return (value + multiple - 1) / multiple * multiple; }
+
+} // namespace
+
+HugePageBuffer::HugePageBuffer(std::size_t count, bool hugePages) : count(count) {
+    if (count == 0) {
+        return;
+    }
+    const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    bytes = roundUp(count * sizeof(double), hugePages ? kHugePageSize : pageSize);
+
+#ifdef MAP_HUGETLB
+    // Explicit huge pages only exist if the administrator reserved them, so failing here is expected
+    if (hugePages) {
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            pageBacking = PageBacking::Huge;
+            return;
+        }
+        memory = nullptr;
+    }
+#endif
+
+    // Over-allocate so the buffer can start on a huge page boundary, transparent huge pages need aligned ranges
+    std::size_t mappedBytes = hugePages ? bytes + kHugePageSize : bytes;
+    void *mapped = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    if (!hugePages) {
+        memory = mapped;
+        return;
+    }
+
+    auto begin = reinterpret_cast<std::uintptr_t>(mapped);
+    std::uintptr_t aligned = roundUp(begin, kHugePageSize);
+    std::size_t head = aligned - begin;
+    std::size_t tail = mappedBytes - head - bytes;
+    if (head > 0) {
+        munmap(mapped, head);
+    }
+    if (tail > 0) {
+        munmap(reinterpret_cast<void *>(aligned + bytes), tail);
+    }
+    memory = reinterpret_cast<void *>(aligned);
+
+#ifdef MADV_HUGEPAGE
+    if (madvise(memory, bytes, MADV_HUGEPAGE) == 0) {
+        pageBacking = PageBacking::TransparentHuge;
+    }
+#endif
+}
+
+HugePageBuffer::~HugePageBuffer() { release(); }
+
+HugePageBuffer::HugePageBuffer(HugePageBuffer &&other) noexcept
+    : memory(std::exchange(other.memory, nullptr)), bytes(std::exchange(other.bytes, 0)),
+      count(std::exchange(other.count, 0)), pageBacking(std::exchange(other.pageBacking, PageBacking::Regular)) {}
+
+HugePageBuffer &HugePageBuffer::operator=(HugePageBuffer &&other) noexcept {
+    if (this != &other) {
+        release();
+        memory = std::exchange(other.memory, nullptr);
+        bytes = std::exchange(other.bytes, 0);
+        count = std::exchange(other.count, 0);
+        pageBacking = std::exchange(other.pageBacking, PageBacking::Regular);
+    }
+    return *this;
+}
+
+double *HugePageBuffer::data() noexcept { return static_cast<double *>(memory); }
+
+const double *HugePageBuffer::data() const noexcept { return static_cast<const double *>(memory); }
+
+std::size_t HugePageBuffer::size() const noexcept { return count; }
+
+PageBacking HugePageBuffer::backing() const noexcept { return pageBacking; }
+
+void HugePageBuffer::release() noexcept {
+    if (memory != nullptr) {
+        munmap(memory, bytes);
+        memory = nullptr;
+    }
+}
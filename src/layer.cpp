@@ -1,7 +1,12 @@
 #include "layer.h"
+#include "bfloat16.h"
 #include "neuron.h"
+#include "sparse_vector.h"
+#include "thread_pool.h"
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <format>
 #include <fstream>
 #include <functional>
@@ -21,6 +26,25 @@ Layer::Layer(size_t size, size_t inputsPerNeuron, std::function<double(double)>
 
 std::vector<Neuron> &Layer::getNeurons() noexcept { return neurons; }
 
+const std::vector<Neuron> &Layer::getNeurons() const noexcept { return neurons; }
+
+const std::function<double(double)> &Layer::getActivationFunction() const noexcept { return activationFunction; }
+
+bool Layer::isNormalized() const noexcept { return normalize; }
+
+bool Layer::isPruned() const noexcept { return pruned; }
+
+bool Layer::isSparse() const noexcept { return pruned && getDensity() <= kSparseDensityBreakEven; }
+
+// Fraction of the weights that are stored, 1.0 unless the layer has been pruned
+double Layer::getDensity() const {
+    if (!pruned || neurons.empty() || neurons.front().getWeights().empty()) {
+        return 1.0;
+    }
+    return static_cast<double>(values.size()) /
+           static_cast<double>(neurons.size() * neurons.front().getWeights().size());
+}
+
 std::vector<double> Layer::getOutputs() const {
     std::vector<double> outputs;
     outputs.reserve(neurons.size());
@@ -34,7 +58,7 @@ double Layer::getActivationResult(double output) const { return activationFuncti
 
 double Layer::getDerivActivationResult(double output) const { return derivActivationFunction(output); }
 
-// Set the weights for all neurons in the layer
+// Set the weights for all neurons in the layer, this discards any previous pruning
 void Layer::setAllWeights(const std::vector<std::vector<double>> &newWeights) {
     if (newWeights.size() != neurons.size()) {
         throw std::invalid_argument(
@@ -48,12 +72,21 @@ void Layer::setAllWeights(const std::vector<std::vector<double>> &newWeights) {
         }
         neurons[i].setWeights(newWeights[i]);
     }
+    clearPruning();
 }
 
-void Layer::setInputsForAllNeurons(const std::vector<double> &inputs) {
-    for (auto &neuron : neurons) {
-        neuron.setInputs(inputs);
+void Layer::setInputsForAllNeurons(const std::vector<double> &inputs, ThreadPool *pool) {
+    if (pool == nullptr) {
+        for (auto &neuron : neurons) {
+            neuron.setInputs(inputs);
+        }
+        return;
     }
+    pool->parallelFor(neurons.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            neurons[i].setInputs(inputs);
+        }
+    });
 }
 
 void Layer::setOutputs(const std::vector<double> &outputs) {
@@ -81,11 +114,42 @@ void Layer::connectLayer(Layer &previousLayer) {
     }
 }
 
-void Layer::calculateOutputs() {
+// Initialize the weights of every neuron from its own stream of the seed, keyed by the layer and the neuron's row, so
+// the result does not depend on how the neurons are split across the threads of the pool. This discards any pruning.
+void Layer::initializeWeights(std::size_t numInputs, std::uint64_t seed, std::size_t layerIndex, ThreadPool *pool) {
+    auto initializeRows = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t row = begin; row < end; ++row) {
+            neurons[row].initializeWeights(numInputs, seed, (static_cast<std::uint64_t>(layerIndex) << 32) | row);
+        }
+    };
+    if (pool == nullptr) {
+        initializeRows(0, neurons.size());
+    } else {
+        pool->parallelFor(neurons.size(), initializeRows);
+    }
+    clearPruning();
+}
+
+// Same as connectLayer, but with reproducible weights from initializeWeights
+void Layer::connectLayer(Layer &previousLayer, std::uint64_t seed, std::size_t layerIndex, ThreadPool *pool) {
+    initializeWeights(previousLayer.getNeurons().size(), seed, layerIndex, pool);
+    setInputsForAllNeurons(previousLayer.getOutputs(), pool);
+}
+
+// When a thread pool is given the neurons are split across its threads, normalized layers are always computed serially
+// because they need the statistics of the whole layer
+void Layer::calculateOutputs(ThreadPool *pool) {
     if (!normalize) {
-        for (auto &neuron : neurons) {
-            double preOutput = neuron.calculatePreOutput();
-            neuron.setOutput(activationFunction(preOutput));
+        auto computeRange = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                double preOutput = neurons[i].calculatePreOutput();
+                neurons[i].setOutput(activationFunction(preOutput));
+            }
+        };
+        if (pool != nullptr) {
+            pool->parallelFor(neurons.size(), computeRange);
+        } else {
+            computeRange(0, neurons.size());
         }
     } else {
         double sum = 0.0;
@@ -111,6 +175,68 @@ void Layer::calculateOutputs() {
     }
 }
 
+// Same as calculateOutputs for pruned layers, but only the stored weights are visited and the inputs are read directly
+// instead of being copied into every neuron
+void Layer::calculateSparseOutputs(const std::vector<double> &inputs, ThreadPool *pool) {
+    if (!pruned) {
+        throw std::logic_error("Sparse outputs can only be calculated for pruned layers");
+    }
+    auto computeRange = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            double sum = neurons[i].getBias();
+            for (std::size_t k = rowStart[i]; k < rowStart[i + 1]; ++k) {
+                sum += inputs[columns[k]] * values[k];
+            }
+            neurons[i].setOutput(activationFunction(sum));
+        }
+    };
+    if (pool != nullptr) {
+        pool->parallelFor(neurons.size(), computeRange);
+    } else {
+        computeRange(0, neurons.size());
+    }
+}
+
+// Compute the outputs of the layer from the outputs of the previous one, choosing the sparse kernel when it is cheaper
+void Layer::feedForward(const std::vector<double> &inputs, ThreadPool *pool) {
+    if (isSparse() && !normalize) {
+        calculateSparseOutputs(inputs, pool);
+        return;
+    }
+    setInputsForAllNeurons(inputs, pool);
+    calculateOutputs(pool);
+}
+
+// Outputs for inputs given as a sparse vector, which only costs one multiply-add per nonzero input and neuron. The
+// inputs are not copied into the neurons. Normalized layers are not supported, the caller densifies the inputs instead.
+void Layer::feedForward(const SparseVector &inputs, ThreadPool *pool) {
+    if (normalize) {
+        throw std::logic_error("Normalized layers cannot take sparse inputs");
+    }
+    auto computeRange = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            neurons[i].setOutput(activationFunction(neurons[i].calculatePreOutput(inputs)));
+        }
+    };
+    if (pool != nullptr) {
+        pool->parallelFor(neurons.size(), computeRange);
+    } else {
+        computeRange(0, neurons.size());
+    }
+}
+
+// Weight update of backpropagation for sparse inputs, with the gradients already set on the neurons. Only the columns
+// of the nonzero inputs change, so only those go through the mask of pruned layers.
+void Layer::updateWeights(const SparseVector &inputs, double learningRate) {
+    for (std::size_t i = 0; i < neurons.size(); ++i) {
+        neurons[i].updateWeights(inputs, learningRate * neurons[i].getGradient());
+        if (pruned) {
+            neurons[i].maskWeights(inputs, columns.data() + rowStart[i], rowStart[i + 1] - rowStart[i],
+                                   values.data() + rowStart[i]);
+        }
+    }
+}
+
 void Layer::applySoftmax() {
     double sumOfExponentials = 0.0;
     for (const auto &neuron : neurons) {
@@ -124,19 +250,226 @@ void Layer::applySoftmax() {
     }
 }
 
-void Layer::save(std::ofstream &out) const {
+// Zero every weight whose magnitude is below the threshold and keep the remaining ones in compressed sparse rows.
+// Pruned weights stay at zero during further training, so the network can be fine-tuned afterwards.
+std::size_t Layer::prune(double threshold) {
+    std::size_t numPruned = 0;
+    for (auto &neuron : neurons) {
+        std::vector<double> weights = neuron.getWeights();
+        for (double &weight : weights) {
+            if (weight != 0.0 && std::abs(weight) < threshold) {
+                weight = 0.0;
+                ++numPruned;
+            }
+        }
+        neuron.setWeights(std::move(weights));
+    }
+    buildSparseStructure();
+    return numPruned;
+}
+
+// Reset the pruned weights to zero after an update and refresh the stored values from the neurons, in place
+void Layer::applyPruningMask() {
+    if (!pruned) {
+        return;
+    }
+    for (std::size_t i = 0; i < neurons.size(); ++i) {
+        neurons[i].maskWeights(columns.data() + rowStart[i], rowStart[i + 1] - rowStart[i],
+                               values.data() + rowStart[i]);
+    }
+}
+
+// The nonzero weights of the neurons define which ones are kept from now on
+void Layer::buildSparseStructure() {
+    rowStart.assign(1, 0);
+    columns.clear();
+    values.clear();
+    for (const auto &neuron : neurons) {
+        const std::vector<double> &weights = neuron.getWeights();
+        for (std::size_t w = 0; w < weights.size(); ++w) {
+            if (weights[w] != 0.0) {
+                columns.push_back(static_cast<std::uint32_t>(w));
+                values.push_back(weights[w]);
+            }
+        }
+        rowStart.push_back(values.size());
+    }
+    pruned = true;
+}
+
+void Layer::clearPruning() noexcept {
+    pruned = false;
+    rowStart.clear();
+    columns.clear();
+    values.clear();
+}
+
+// Pruned layers keep their pruning when the model is loaded again. They are written as compressed sparse rows or
+// masked, whichever takes less space. With bfloat16 precision the weights are rounded when writing and the rows of
+// dense and masked layers are written back to back.
+void Layer::save(std::ofstream &out, WeightPrecision precision) const {
     std::size_t numNeurons = neurons.size();
     out.write(reinterpret_cast<const char *>(&numNeurons), sizeof(numNeurons));
-    for (const auto &neuron : neurons) {
-        neuron.save(out);
+    bool bfloat16 = precision == WeightPrecision::Bfloat16;
+    std::size_t numInputs = neurons.empty() ? 0 : neurons.front().getWeights().size();
+    LayerEncoding encoding = bfloat16 ? LayerEncoding::DenseBfloat16 : LayerEncoding::Dense;
+    if (pruned) {
+        std::size_t weightBytes = bfloat16 ? sizeof(std::uint16_t) : sizeof(double);
+        std::size_t sparseBytes = sizeof(std::size_t) * (rowStart.size() + 1) +
+                                  (sizeof(std::uint32_t) + weightBytes) * values.size();
+        std::size_t maskedBytes = (numNeurons * numInputs + 7) / 8 + weightBytes * numNeurons * numInputs;
+        if (sparseBytes <= maskedBytes) {
+            encoding = bfloat16 ? LayerEncoding::SparseBfloat16 : LayerEncoding::Sparse;
+        } else {
+            encoding = bfloat16 ? LayerEncoding::MaskedBfloat16 : LayerEncoding::Masked;
+        }
+    }
+    out.write(reinterpret_cast<const char *>(&encoding), sizeof(encoding));
+
+    if (encoding == LayerEncoding::Dense) {
+        for (const auto &neuron : neurons) {
+            neuron.save(out);
+        }
+        return;
+    }
+    out.write(reinterpret_cast<const char *>(&numInputs), sizeof(numInputs));
+    if (encoding == LayerEncoding::Masked || encoding == LayerEncoding::MaskedBfloat16) {
+        // Bit w of row i is bit (i * numInputs + w) of the mask, starting from the lowest bit of each byte
+        std::vector<std::uint8_t> mask((numNeurons * numInputs + 7) / 8, 0);
+        for (std::size_t i = 0; i < numNeurons; ++i) {
+            for (std::size_t k = rowStart[i]; k < rowStart[i + 1]; ++k) {
+                std::size_t bit = i * numInputs + columns[k];
+                mask[bit / 8] |= static_cast<std::uint8_t>(1U << (bit % 8));
+            }
+        }
+        out.write(reinterpret_cast<const char *>(mask.data()), static_cast<std::streamsize>(mask.size()));
+    }
+    if (encoding != LayerEncoding::Sparse && encoding != LayerEncoding::SparseBfloat16) {
+        for (const auto &neuron : neurons) {
+            writeWeights(out, neuron.getWeights(), precision);
+        }
+        return;
     }
+    std::size_t numValues = values.size();
+    out.write(reinterpret_cast<const char *>(&numValues), sizeof(numValues));
+    out.write(reinterpret_cast<const char *>(rowStart.data()), sizeof(std::size_t) * rowStart.size());
+    out.write(reinterpret_cast<const char *>(columns.data()), sizeof(std::uint32_t) * numValues);
+    writeWeights(out, values, precision);
 }
 
-void Layer::load(std::ifstream &in) {
+// Files written before the encoding tag was introduced only contain dense layers
+void Layer::load(std::ifstream &in, bool legacyFormat) {
     std::size_t numNeurons;
     in.read(reinterpret_cast<char *>(&numNeurons), sizeof(numNeurons));
     neurons.resize(numNeurons);
-    for (auto &neuron : neurons) {
-        neuron.load(in);
+    LayerEncoding encoding = LayerEncoding::Dense;
+    if (!legacyFormat) {
+        in.read(reinterpret_cast<char *>(&encoding), sizeof(encoding));
+    }
+
+    if (encoding == LayerEncoding::Dense) {
+        for (auto &neuron : neurons) {
+            neuron.load(in);
+        }
+        clearPruning();
+        return;
+    }
+    if (encoding != LayerEncoding::Sparse && encoding != LayerEncoding::DenseBfloat16 &&
+        encoding != LayerEncoding::SparseBfloat16 && encoding != LayerEncoding::Masked &&
+        encoding != LayerEncoding::MaskedBfloat16) {
+        throw std::runtime_error(std::format("Unknown layer encoding {}", static_cast<int>(encoding)));
+    }
+    WeightPrecision precision = encoding == LayerEncoding::Sparse || encoding == LayerEncoding::Masked
+                                    ? WeightPrecision::Double
+                                    : WeightPrecision::Bfloat16;
+
+    // Sizes read from the file are checked against the network before anything is allocated from them
+    std::size_t numInputs;
+    in.read(reinterpret_cast<char *>(&numInputs), sizeof(numInputs));
+    if (!in) {
+        throw std::runtime_error("Corrupted layer in model file");
+    }
+    for (const auto &neuron : neurons) {
+        if (neuron.getWeights().size() != numInputs) {
+            throw std::runtime_error(std::format("Layer in model file has {} inputs per neuron, expected {}",
+                                                 numInputs, neuron.getWeights().size()));
+        }
+    }
+
+    if (encoding == LayerEncoding::DenseBfloat16) {
+        for (auto &neuron : neurons) {
+            std::vector<double> weights(numInputs);
+            readWeights(in, weights, precision);
+            neuron.setWeights(std::move(weights));
+        }
+        if (!in) {
+            throw std::runtime_error("Corrupted dense layer in model file");
+        }
+        clearPruning();
+        return;
+    }
+
+    if (encoding == LayerEncoding::Masked || encoding == LayerEncoding::MaskedBfloat16) {
+        std::vector<std::uint8_t> mask((numNeurons * numInputs + 7) / 8);
+        in.read(reinterpret_cast<char *>(mask.data()), static_cast<std::streamsize>(mask.size()));
+        std::vector<std::vector<double>> rows(numNeurons, std::vector<double>(numInputs));
+        for (auto &row : rows) {
+            readWeights(in, row, precision);
+        }
+        if (!in) {
+            throw std::runtime_error("Corrupted masked layer in model file");
+        }
+        rowStart.assign(1, 0);
+        columns.clear();
+        values.clear();
+        for (std::size_t i = 0; i < numNeurons; ++i) {
+            for (std::size_t w = 0; w < numInputs; ++w) {
+                std::size_t bit = i * numInputs + w;
+                if ((mask[bit / 8] >> (bit % 8) & 1U) != 0) {
+                    columns.push_back(static_cast<std::uint32_t>(w));
+                    values.push_back(rows[i][w]);
+                } else {
+                    rows[i][w] = 0.0;
+                }
+            }
+            rowStart.push_back(values.size());
+            neurons[i].setWeights(std::move(rows[i]));
+        }
+        pruned = true;
+        return;
+    }
+
+    std::size_t numValues;
+    in.read(reinterpret_cast<char *>(&numValues), sizeof(numValues));
+    if (!in || numValues > numNeurons * numInputs) {
+        throw std::runtime_error("Corrupted sparse layer in model file");
+    }
+    rowStart.resize(numNeurons + 1);
+    columns.resize(numValues);
+    values.resize(numValues);
+    in.read(reinterpret_cast<char *>(rowStart.data()), sizeof(std::size_t) * rowStart.size());
+    in.read(reinterpret_cast<char *>(columns.data()), sizeof(std::uint32_t) * numValues);
+    readWeights(in, values, precision);
+    // Columns must increase within each row, the mask of the sparse update searches them
+    bool validRows = rowStart.front() == 0 && rowStart.back() == numValues && std::ranges::is_sorted(rowStart) &&
+                     std::ranges::all_of(columns, [&](std::uint32_t column) { return column < numInputs; });
+    for (std::size_t i = 0; validRows && i < numNeurons; ++i) {
+        for (std::size_t k = rowStart[i] + 1; k < rowStart[i + 1]; ++k) {
+            validRows = validRows && columns[k - 1] < columns[k];
+        }
+    }
+    if (!in || !validRows) {
+        clearPruning();
+        throw std::runtime_error("Corrupted sparse layer in model file");
+    }
+
+    // The neurons keep the dense weights for training and the other inference paths
+    for (std::size_t i = 0; i < numNeurons; ++i) {
+        std::vector<double> weights(numInputs, 0.0);
+        for (std::size_t k = rowStart[i]; k < rowStart[i + 1]; ++k) {
+            weights[columns[k]] = values[k];
+        }
+        neurons[i].setWeights(std::move(weights));
     }
+    pruned = true;
 }
@@ -1,13 +1,32 @@
 #include "mlp.h"
+#include "bfloat16.h"
+#include "checkpointer.h"
+#include "counter_rng.h"
+#include "embedding_layer.h"
 #include "layer.h"
 #include "neuron.h"
+#include "preprocessor.h"
+#include "sparse_vector.h"
+#include "thread_pool.h"
+#include "transport.h"
+#include "utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <format>
 #include <fstream>
 #include <functional>
+#include <iomanip>
 #include <ios>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 class EmptyNetwork : public std::logic_error {
@@ -18,28 +37,41 @@ class ModelIOError : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
+namespace {
+
+// Model files start with this tag and a format version, files written before it existed start directly with the
+// first layer and are read as the legacy format. Version 2 added the preprocessor before the layers, version 3 the
+// embeddings after it and version 4 the masked encoding of pruned layers.
+constexpr std::uint64_t kModelFileMagic = 0x4C444F4D50504C4D; // "MLPPMODL" when read as little endian bytes
+constexpr std::uint32_t kModelFileVersion = 4;
+
+} // namespace
+
+// With numThreads above one the network starts with the thread pool of setParallelism, and the initial weights of its
+// wide layers are already drawn on it. They are the same weights a single thread would draw.
 MLP::MLP(const std::vector<size_t> &layersNodes, double lr, const std::function<double(double)> &activationFunc,
-         const std::function<double(double)> &derivActivationFunc, const bool softmax, const bool constantWeightInit)
-    : learningRate(lr), softmax(softmax) {
+         const std::function<double(double)> &derivActivationFunc, const bool softmax, const bool constantWeightInit,
+         std::size_t numThreads)
+    : learningRate(lr), softmax(softmax), seed(constantWeightInit ? 42 : std::random_device{}()) {
     if (layersNodes.size() < 2) {
         throw std::invalid_argument("Network must have at least two layers (input and output).");
     }
 
-    for (std::size_t i = 0; i < layersNodes.size(); ++i) {
-        // inputsPerNeuron is the number of neurons in the previous layer, 0 for the first layer
-        std::size_t inputsPerNeuron = (i == 0 ? 0 : layersNodes[i - 1]);
-        layers.emplace_back(layersNodes[i], inputsPerNeuron, activationFunc, derivActivationFunc, false,
-                            constantWeightInit);
+    // The weights are created when connecting each layer to the previous one
+    for (std::size_t nodes : layersNodes) {
+        layers.emplace_back(nodes, 0, activationFunc, derivActivationFunc, false, constantWeightInit);
     }
 
+    setParallelism(numThreads);
     for (std::size_t i = 1; i < layers.size(); ++i) {
-        layers[i].connectLayer(layers[i - 1]);
+        std::size_t work = layers[i].getNeurons().size() * layers[i - 1].getNeurons().size();
+        layers[i].connectLayer(layers[i - 1], seed, i, work >= minLayerWork ? threadPool.get() : nullptr);
     }
 }
 
-MLP::MLP(double lr) : learningRate(lr) {}
+MLP::MLP(double lr) : learningRate(lr), seed(std::random_device{}()) {}
 
-MLP::MLP(double lr, const bool softmax) : learningRate(lr), softmax(softmax) {}
+MLP::MLP(double lr, const bool softmax) : learningRate(lr), softmax(softmax), seed(std::random_device{}()) {}
 
 std::vector<double> MLP::getResult() const {
     if (layers.empty()) {
@@ -50,6 +82,40 @@ std::vector<double> MLP::getResult() const {
 
 std::vector<Layer> &MLP::getLayers() noexcept { return layers; }
 
+const std::vector<Layer> &MLP::getLayers() const noexcept { return layers; }
+
+bool MLP::usesSoftmax() const noexcept { return softmax; }
+
+std::uint64_t MLP::getSeed() const noexcept { return seed; }
+
+const Preprocessor &MLP::getPreprocessor() const noexcept { return preprocessor; }
+
+const EmbeddingLayer &MLP::getEmbeddings() const noexcept { return embeddings; }
+
+std::size_t MLP::getNumParameters() const noexcept {
+    std::size_t numParameters = 0;
+    for (const auto &layer : layers) {
+        for (const auto &neuron : layer.getNeurons()) {
+            numParameters += neuron.getWeights().size();
+        }
+    }
+    return numParameters + embeddings.getTable().size();
+}
+
+// All the weights of the network in a single vector, layer after layer and neuron after neuron, followed by the
+// embedding table
+std::vector<double> MLP::getParameters() const {
+    std::vector<double> parameters;
+    parameters.reserve(getNumParameters());
+    for (const auto &layer : layers) {
+        for (const auto &neuron : layer.getNeurons()) {
+            parameters.insert(parameters.end(), neuron.getWeights().begin(), neuron.getWeights().end());
+        }
+    }
+    parameters.insert(parameters.end(), embeddings.getTable().begin(), embeddings.getTable().end());
+    return parameters;
+}
+
 void MLP::setWeightsAllLayers(const std::vector<std::vector<std::vector<double>>> &newWeights) {
     if (newWeights.size() != layers.size()) {
         throw std::invalid_argument(
@@ -61,13 +127,92 @@ void MLP::setWeightsAllLayers(const std::vector<std::vector<std::vector<double>>
     }
 }
 
+// Inverse of getParameters, pruned layers keep their pruning
+void MLP::setParameters(const std::vector<double> &parameters) {
+    if (parameters.size() != getNumParameters()) {
+        throw std::invalid_argument(std::format("Mismatch in number of parameters, expected {}, got {}",
+                                                getNumParameters(), parameters.size()));
+    }
+    auto next = parameters.begin();
+    for (auto &layer : layers) {
+        for (auto &neuron : layer.getNeurons()) {
+            auto end = next + static_cast<std::ptrdiff_t>(neuron.getWeights().size());
+            neuron.setWeights(std::vector<double>(next, end));
+            next = end;
+        }
+        layer.applyPruningMask();
+    }
+    if (!embeddings.empty()) {
+        embeddings.setTable(std::vector<double>(next, parameters.end()));
+    }
+}
+
+// Evaluate the neurons of each layer with numThreads threads (including the caller) when the layer has at least
+// minLayerWork multiply-adds, smaller layers are not worth the synchronization. A value of 0 or 1 disables it.
+void MLP::setParallelism(std::size_t numThreads, std::size_t minLayerWork) {
+    threadPool = numThreads > 1 ? std::make_shared<ThreadPool>(numThreads) : nullptr;
+    this->minLayerWork = minLayerWork;
+}
+
+// Visit the training samples in a different order every epoch. The order only depends on the seed and the epoch, so
+// training resumed from a checkpoint sees the same orders it would have without stopping.
+void MLP::setShuffle(bool shuffle) noexcept { this->shuffle = shuffle; }
+
+// Fit one transform per input feature on the training data, from then on train and predict take raw inputs and the
+// transforms are saved with the model. The statistics pass uses the threads set by setParallelism.
+void MLP::fitPreprocessor(const std::vector<std::vector<double>> &inputData,
+                          const std::vector<FeatureTransform> &transforms) {
+    if (layers.empty()) {
+        throw EmptyNetwork("No layers in the network.");
+    }
+    if (transforms.size() != layers.front().getNeurons().size()) {
+        throw std::invalid_argument(std::format("Mismatch in number of transforms and inputs, expected {}, got {}",
+                                                layers.front().getNeurons().size(), transforms.size()));
+    }
+    preprocessor.fit(inputData, transforms, threadPool.get());
+}
+
+// Learn a vector of the given dimension for every category of each categorical column. The vectors of a sample's
+// categories are the first inputs of the network, so its input layer must have room for one vector per column, the
+// rest of the inputs are the numeric features. The categorical overloads of feedForward, predict and train use them.
+void MLP::setEmbeddings(const std::vector<std::size_t> &cardinalities, std::size_t dimension) {
+    if (layers.size() < 2) {
+        throw EmptyNetwork("Network must have at least two layers to use embeddings.");
+    }
+    EmbeddingLayer newEmbeddings(cardinalities, dimension, seed);
+    if (newEmbeddings.outputSize() > layers.front().getNeurons().size()) {
+        throw std::invalid_argument(std::format("Embeddings take {} inputs, but the network only has {}",
+                                                newEmbeddings.outputSize(), layers.front().getNeurons().size()));
+    }
+    embeddings = std::move(newEmbeddings);
+}
+
+// Constant initialization switches the network to the fixed seed of the other constructor, so getSeed, the sample
+// order and the embeddings match the weights of the layers added from then on
 void MLP::addLayer(size_t numNodes, const std::function<double(double)> &activationFunc,
                    const std::function<double(double)> &derivActivationFunc, const bool normalize,
                    const bool constantWeightInit) {
-    std::size_t inputsPerNeuron = layers.empty() ? 0 : layers.back().getNeurons().size();
-    layers.emplace_back(numNodes, inputsPerNeuron, activationFunc, derivActivationFunc, normalize, constantWeightInit);
+    if (constantWeightInit) {
+        seed = 42;
+    }
+    layers.emplace_back(numNodes, 0, activationFunc, derivActivationFunc, normalize, constantWeightInit);
     if (layers.size() > 1) {
-        layers.back().connectLayer(layers[layers.size() - 2]);
+        layers.back().connectLayer(layers[layers.size() - 2], seed, layers.size() - 1);
+    }
+}
+
+// Draw new weights for the whole network from the given seed, the same seed gives the same weights whatever the
+// parallelism of the network. Any pruning is discarded.
+void MLP::initializeWeights(std::uint64_t seed) {
+    this->seed = seed;
+    for (std::size_t i = 1; i < layers.size(); ++i) {
+        std::size_t numInputs = layers[i - 1].getNeurons().size();
+        std::size_t work = layers[i].getNeurons().size() * numInputs;
+        ThreadPool *pool = work >= minLayerWork ? threadPool.get() : nullptr;
+        layers[i].initializeWeights(numInputs, seed, i, pool);
+    }
+    if (!embeddings.empty()) {
+        embeddings = EmbeddingLayer(embeddings.getCardinalities(), embeddings.dimension(), seed);
     }
 }
 
@@ -78,10 +223,17 @@ void MLP::feedForward(const std::vector<double> &inputValues) {
 
     // Directly set the outputs of the input layer.
     layers.front().setOutputs(inputValues);
+    sparseInputActive = false;
+    embeddingInputActive = false;
 
     for (size_t i = 1; i < layers.size(); ++i) {
-        layers[i].setInputsForAllNeurons(layers[i - 1].getOutputs());
-        layers[i].calculateOutputs();
+        // Sparse layers only do as many multiply-adds as stored weights
+        std::size_t work = layers[i].getNeurons().size() * layers[i - 1].getNeurons().size();
+        if (layers[i].isSparse()) {
+            work = static_cast<std::size_t>(static_cast<double>(work) * layers[i].getDensity());
+        }
+        ThreadPool *pool = work >= minLayerWork ? threadPool.get() : nullptr;
+        layers[i].feedForward(layers[i - 1].getOutputs(), pool);
     }
 
     if (softmax) {
@@ -90,6 +242,69 @@ void MLP::feedForward(const std::vector<double> &inputValues) {
     }
 }
 
+// Feed inputs given as a sparse vector. The first layer only visits the weights of the nonzero inputs, so its cost
+// depends on their number rather than on the number of inputs. The outputs of the input layer are not set. Inputs are
+// never preprocessed, since the transforms would make them dense.
+void MLP::feedForward(const SparseVector &inputValues) {
+    if (layers.size() < 2) {
+        throw EmptyNetwork("Network must have at least two layers to take sparse inputs.");
+    }
+    std::size_t numInputs = layers.front().getNeurons().size();
+    if (inputValues.size != numInputs || inputValues.indices.size() != inputValues.values.size()) {
+        throw std::invalid_argument(
+            std::format("Mismatch in number of inputs provided, expected {}, got {}", numInputs, inputValues.size));
+    }
+    if (std::ranges::any_of(inputValues.indices, [&](std::uint32_t index) { return index >= numInputs; })) {
+        throw std::out_of_range("Sparse input index out of range.");
+    }
+    // Normalization needs the statistics of the whole layer, for which the inputs are expanded
+    if (layers[1].isNormalized()) {
+        feedForward(inputValues.toDense());
+        return;
+    }
+
+    sparseInput = inputValues;
+    sparseInputActive = true;
+    embeddingInputActive = false;
+    std::size_t work = layers[1].getNeurons().size() * inputValues.nonZeros();
+    layers[1].feedForward(sparseInput, work >= minLayerWork ? threadPool.get() : nullptr);
+    for (size_t i = 2; i < layers.size(); ++i) {
+        std::size_t layerWork = layers[i].getNeurons().size() * layers[i - 1].getNeurons().size();
+        if (layers[i].isSparse()) {
+            layerWork = static_cast<std::size_t>(static_cast<double>(layerWork) * layers[i].getDensity());
+        }
+        layers[i].feedForward(layers[i - 1].getOutputs(), layerWork >= minLayerWork ? threadPool.get() : nullptr);
+    }
+
+    if (softmax) {
+        layers.back().applySoftmax();
+    }
+}
+
+// Feed the embeddings of the sample's categories followed by its numeric features. Inputs are never preprocessed, since
+// the embeddings change during training, so a fitted preprocessor is rejected rather than silently ignored.
+void MLP::feedForward(const CategoricalSample &sample) {
+    if (embeddings.empty()) {
+        throw std::logic_error("Network has no embeddings, they must be set with setEmbeddings first.");
+    }
+    if (!preprocessor.empty()) {
+        throw std::logic_error("Categorical samples cannot be preprocessed, the embeddings change during training.");
+    }
+    embeddings.validate(sample.categories);
+    std::size_t numFeatures = layers.front().getNeurons().size() - embeddings.outputSize();
+    if (sample.features.size() != numFeatures) {
+        throw std::invalid_argument(std::format("Mismatch in number of numeric features provided, expected {}, got {}",
+                                                numFeatures, sample.features.size()));
+    }
+
+    embeddedInput.resize(layers.front().getNeurons().size());
+    embeddings.gather(sample.categories, embeddedInput.data());
+    std::ranges::copy(sample.features, embeddedInput.begin() + static_cast<std::ptrdiff_t>(embeddings.outputSize()));
+    feedForward(embeddedInput);
+    embeddingCategories = sample.categories;
+    embeddingInputActive = true;
+}
+
 void MLP::backPropagate(const std::vector<double> &targetValues) {
     if (layers.empty()) {
         throw EmptyNetwork("No layers in the network.");
@@ -107,18 +322,33 @@ void MLP::backPropagate(const std::vector<double> &targetValues) {
     for (int layerNum = static_cast<int>(layers.size()) - 2; layerNum > 0; --layerNum) {
         Layer &hiddenLayer = layers[layerNum];
         Layer &nextLayer = layers[layerNum + 1];
-        for (auto &neuron : hiddenLayer.getNeurons()) {
+        for (size_t j = 0; j < hiddenLayer.getNeurons().size(); ++j) {
+            // Each neuron of the next layer contributes through the weight of its connection to this neuron
+            Neuron &neuron = hiddenLayer.getNeurons()[j];
             double sum = 0.0;
-            for (size_t n = 0; n < nextLayer.getNeurons().size(); ++n) {
-                sum += neuron.getWeights()[n] * nextLayer.getNeurons()[n].getGradient();
+            for (const Neuron &nextNeuron : nextLayer.getNeurons()) {
+                sum += nextNeuron.getWeights()[j] * nextNeuron.getGradient();
             }
             double gradient = sum * hiddenLayer.getDerivActivationResult(neuron.getOutput());
             neuron.setGradient(gradient);
         }
     }
 
+    // Gradients of the embedded inputs, taken before the weights of the first layer change
+    if (embeddingInputActive) {
+        embeddingGradients.assign(embeddings.outputSize(), 0.0);
+        for (const Neuron &neuron : layers[1].getNeurons()) {
+            for (std::size_t j = 0; j < embeddingGradients.size(); ++j) {
+                embeddingGradients[j] += neuron.getWeights()[j] * neuron.getGradient();
+            }
+        }
+    }
+
     // Update weights
-    for (size_t layerNum = 1; layerNum < layers.size(); ++layerNum) {
+    if (sparseInputActive) {
+        layers[1].updateWeights(sparseInput, learningRate);
+    }
+    for (size_t layerNum = sparseInputActive ? 2 : 1; layerNum < layers.size(); ++layerNum) {
         Layer &layer = layers[layerNum];
         Layer &prevLayer = layers[layerNum - 1];
         for (Neuron &neuron : layer.getNeurons()) {
@@ -128,6 +358,54 @@ void MLP::backPropagate(const std::vector<double> &targetValues) {
             }
             neuron.setWeights(newWeights);
         }
+        layer.applyPruningMask();
+    }
+    // Only the rows of the sample's categories have a gradient
+    if (embeddingInputActive) {
+        embeddings.update(embeddingCategories, embeddingGradients.data(), learningRate);
+    }
+}
+
+// Remove the given fraction of weights with the smallest magnitude, either ranking all the weights of the network
+// together or each layer on its own. Pruned layers switch to a sparse representation that is kept when saving, and
+// calling train afterwards fine-tunes the remaining weights.
+void MLP::prune(double sparsity, bool perLayer) {
+    if (sparsity < 0.0 || sparsity > 1.0) {
+        throw std::invalid_argument(std::format("Sparsity must be between 0 and 1, got {}", sparsity));
+    }
+
+    // Magnitude below which the requested fraction of the given weights lies
+    auto thresholdFor = [sparsity](std::vector<double> &magnitudes) {
+        auto numPruned = static_cast<std::size_t>(sparsity * static_cast<double>(magnitudes.size()));
+        if (numPruned >= magnitudes.size()) {
+            return std::numeric_limits<double>::infinity();
+        }
+        std::ranges::nth_element(magnitudes, magnitudes.begin() + static_cast<std::ptrdiff_t>(numPruned));
+        return magnitudes[numPruned];
+    };
+    auto collectMagnitudes = [](const Layer &layer, std::vector<double> &magnitudes) {
+        for (const auto &neuron : layer.getNeurons()) {
+            for (double weight : neuron.getWeights()) {
+                magnitudes.push_back(std::abs(weight));
+            }
+        }
+    };
+
+    if (perLayer) {
+        for (std::size_t l = 1; l < layers.size(); ++l) {
+            std::vector<double> magnitudes;
+            collectMagnitudes(layers[l], magnitudes);
+            layers[l].prune(thresholdFor(magnitudes));
+        }
+        return;
+    }
+    std::vector<double> magnitudes;
+    for (std::size_t l = 1; l < layers.size(); ++l) {
+        collectMagnitudes(layers[l], magnitudes);
+    }
+    double threshold = thresholdFor(magnitudes);
+    for (std::size_t l = 1; l < layers.size(); ++l) {
+        layers[l].prune(threshold);
     }
 }
 
@@ -137,28 +415,201 @@ void MLP::train(const std::vector<std::vector<double>> &inputData, const std::ve
         throw std::invalid_argument("Input data and target data must have the same number of entries.");
     }
 
+    // The whole dataset is preprocessed once instead of in every epoch
+    std::vector<std::vector<double>> preprocessed;
+    if (!preprocessor.empty()) {
+        preprocessed = preprocessor.transform(inputData);
+    }
+    const auto &inputs = preprocessor.empty() ? inputData : preprocessed;
+    for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+        trainEpoch(inputs, targetData, epoch);
+    }
+}
+
+// Train on sparse inputs, with the same sample order as the dense overload
+void MLP::train(const std::vector<SparseVector> &inputData, const std::vector<std::vector<double>> &targetData,
+                std::size_t epochs) {
+    if (inputData.size() != targetData.size()) {
+        throw std::invalid_argument("Input data and target data must have the same number of entries.");
+    }
+    if (!preprocessor.empty()) {
+        throw std::logic_error("Sparse inputs cannot be preprocessed, the transforms would make them dense.");
+    }
+    for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+        orderSamples(inputData.size(), epoch);
+        for (std::size_t i : sampleOrder) {
+            feedForward(inputData[i]);
+            backPropagate(targetData[i]);
+        }
+    }
+}
+
+// Train the network and the embeddings on categorical samples, with the same sample order as the dense overload
+void MLP::train(const std::vector<CategoricalSample> &inputData, const std::vector<std::vector<double>> &targetData,
+                std::size_t epochs) {
+    if (inputData.size() != targetData.size()) {
+        throw std::invalid_argument("Input data and target data must have the same number of entries.");
+    }
     for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
-        for (std::size_t i = 0; i < inputData.size(); ++i) {
+        orderSamples(inputData.size(), epoch);
+        for (std::size_t i : sampleOrder) {
             feedForward(inputData[i]);
             backPropagate(targetData[i]);
         }
     }
 }
 
+// Train while saving a checkpoint every checkpointInterval epochs from a background thread, so training does not stop
+// for the disk. If the checkpoint file already exists, training resumes from the epoch it was saved at.
+void MLP::train(const std::vector<std::vector<double>> &inputData, const std::vector<std::vector<double>> &targetData,
+                std::size_t epochs, const std::string &checkpointPath, std::size_t checkpointInterval) {
+    if (inputData.size() != targetData.size()) {
+        throw std::invalid_argument("Input data and target data must have the same number of entries.");
+    }
+    if (checkpointInterval == 0) {
+        throw std::invalid_argument("Checkpoint interval must be at least one epoch.");
+    }
+
+    std::size_t firstEpoch = 0;
+    std::vector<double> parameters;
+    if (Checkpointer::load(checkpointPath, getNumParameters(), firstEpoch, parameters)) {
+        setParameters(parameters);
+    }
+
+    std::vector<std::vector<double>> preprocessed;
+    if (!preprocessor.empty()) {
+        preprocessed = preprocessor.transform(inputData);
+    }
+    const auto &inputs = preprocessor.empty() ? inputData : preprocessed;
+    Checkpointer checkpointer(checkpointPath);
+    for (std::size_t epoch = firstEpoch; epoch < epochs; ++epoch) {
+        trainEpoch(inputs, targetData, epoch);
+        if ((epoch + 1) % checkpointInterval == 0 || epoch + 1 == epochs) {
+            checkpointer.submit(epoch + 1, getParameters());
+        }
+    }
+    checkpointer.flush();
+}
+
+// Data-parallel training, called by every worker of the transport with its own shard of the data. All the workers
+// start from the weights of rank 0, and syncsPerEpoch times per epoch the updates each one made since the last sync
+// are averaged over all of them, so they hold the same model at every sync and when training ends. Shards may differ
+// in size, but the preprocessor, if any, must have been fitted the same way on every worker.
+void MLP::train(const std::vector<std::vector<double>> &inputData, const std::vector<std::vector<double>> &targetData,
+                std::size_t epochs, Transport &transport, std::size_t syncsPerEpoch) {
+    if (inputData.size() != targetData.size()) {
+        throw std::invalid_argument("Input data and target data must have the same number of entries.");
+    }
+    if (syncsPerEpoch == 0) {
+        throw std::invalid_argument("Workers must synchronize at least once per epoch.");
+    }
+
+    // The all-reduces below assume every rank has the same parameters, so gather the counts first and let all the
+    // ranks fail together instead of mixing unrelated chunks or waiting on each other
+    std::vector<double> counts(transport.size());
+    counts[transport.rank()] = static_cast<double>(getNumParameters());
+    ringAllReduce(transport, counts);
+    for (std::size_t rank = 1; rank < counts.size(); ++rank) {
+        if (counts[rank] != counts[0]) {
+            throw std::invalid_argument(std::format("Rank 0 has {} parameters, but rank {} has {}", counts[0], rank,
+                                                    counts[rank]));
+        }
+    }
+
+    std::vector<std::vector<double>> preprocessed;
+    if (!preprocessor.empty()) {
+        preprocessed = preprocessor.transform(inputData);
+    }
+    const auto &inputs = preprocessor.empty() ? inputData : preprocessed;
+
+    // Summing with zeros from every other rank broadcasts the weights of rank 0
+    std::vector<double> synced = getParameters();
+    if (transport.rank() != 0) {
+        std::ranges::fill(synced, 0.0);
+    }
+    ringAllReduce(transport, synced);
+    setParameters(synced);
+
+    std::vector<double> update(synced.size());
+    auto scale = 1.0 / static_cast<double>(transport.size());
+    for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+        orderSamples(inputs.size(), epoch);
+        for (std::size_t sync = 0; sync < syncsPerEpoch; ++sync) {
+            std::size_t begin = inputs.size() * sync / syncsPerEpoch;
+            std::size_t end = inputs.size() * (sync + 1) / syncsPerEpoch;
+            for (std::size_t i = begin; i < end; ++i) {
+                feedForward(inputs[sampleOrder[i]]);
+                backPropagate(targetData[sampleOrder[i]]);
+            }
+
+            std::vector<double> parameters = getParameters();
+            for (std::size_t p = 0; p < parameters.size(); ++p) {
+                update[p] = parameters[p] - synced[p];
+            }
+            ringAllReduce(transport, update);
+            for (std::size_t p = 0; p < synced.size(); ++p) {
+                synced[p] += update[p] * scale;
+            }
+            setParameters(synced);
+        }
+    }
+}
+
+// Only the indices of the samples are shuffled, the samples themselves are never moved
+void MLP::orderSamples(std::size_t numSamples, std::size_t epoch) {
+    sampleOrder.resize(numSamples);
+    std::iota(sampleOrder.begin(), sampleOrder.end(), std::size_t{0});
+    if (shuffle) {
+        CounterRng(seed, kShuffleStream + epoch).shuffle(sampleOrder);
+    }
+}
+
+void MLP::trainEpoch(const std::vector<std::vector<double>> &inputData,
+                     const std::vector<std::vector<double>> &targetData, std::size_t epoch) {
+    orderSamples(inputData.size(), epoch);
+    for (std::size_t i : sampleOrder) {
+        feedForward(inputData[i]);
+        backPropagate(targetData[i]);
+    }
+}
+
 std::vector<double> MLP::predict(const std::vector<double> &input) {
+    if (preprocessor.empty()) {
+        feedForward(input);
+    } else {
+        feedForward(preprocessor.transform(input));
+    }
+    return getResult();
+}
+
+std::vector<double> MLP::predict(const SparseVector &input) {
+    if (!preprocessor.empty()) {
+        throw std::logic_error("Sparse inputs cannot be preprocessed, the transforms would make them dense.");
+    }
     feedForward(input);
     return getResult();
 }
 
-void MLP::save(const std::string &filename) {
+std::vector<double> MLP::predict(const CategoricalSample &input) {
+    feedForward(input);
+    return getResult();
+}
+
+// Saving with bfloat16 precision makes the file about 4 times smaller, the weights are rounded to 8 bits of mantissa
+void MLP::save(const std::string &filename, WeightPrecision precision) {
     std::ofstream file(filename, std::ios::binary);
     if (!file) {
         throw ModelIOError("Unable to open file for saving: " + filename);
     }
 
+    file.write(reinterpret_cast<const char *>(&kModelFileMagic), sizeof(kModelFileMagic));
+    file.write(reinterpret_cast<const char *>(&kModelFileVersion), sizeof(kModelFileVersion));
+    preprocessor.save(file);
+    embeddings.save(file, precision);
+
     // Serialize each layer
     for (const auto &layer : getLayers()) {
-        layer.save(file);
+        layer.save(file, precision);
     }
 }
 
@@ -168,8 +619,181 @@ void MLP::load(const std::string &filename) {
         throw ModelIOError("Unable to open file for loading: " + filename);
     }
 
-    // Deserialize each layer
-    for (auto &layer : getLayers()) {
-        layer.load(file);
+    std::uint64_t magic = 0;
+    file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    bool legacyFormat = magic != kModelFileMagic;
+    std::uint32_t version = 0;
+    if (legacyFormat) {
+        file.clear();
+        file.seekg(0);
+    } else {
+        file.read(reinterpret_cast<char *>(&version), sizeof(version));
+        if (version > kModelFileVersion) {
+            throw ModelIOError(std::format("Model file {} has format version {}, the newest supported is {}",
+                                           filename, version, kModelFileVersion));
+        }
     }
-}
\ No newline at end of file
+
+    Preprocessor loadedPreprocessor;
+    if (!legacyFormat && version >= 2) {
+        loadedPreprocessor.load(file);
+    }
+    if (!loadedPreprocessor.empty() &&
+        (layers.empty() || loadedPreprocessor.numFeatures() != layers.front().getNeurons().size())) {
+        throw ModelIOError(std::format("Model file {} preprocesses {} features, which does not match the network",
+                                       filename, loadedPreprocessor.numFeatures()));
+    }
+
+    EmbeddingLayer loadedEmbeddings;
+    if (!legacyFormat && version >= 3) {
+        loadedEmbeddings.load(file);
+    }
+    if (!layers.empty() && loadedEmbeddings.outputSize() > layers.front().getNeurons().size()) {
+        throw ModelIOError(std::format("Model file {} has embeddings for {} inputs, which does not match the network",
+                                       filename, loadedEmbeddings.outputSize()));
+    }
+
+    // Deserialize each layer into a copy, so a file that fails part way leaves the network as it was
+    std::vector<Layer> loadedLayers = layers;
+    for (auto &layer : loadedLayers) {
+        layer.load(file, legacyFormat);
+    }
+    if (!file) {
+        throw ModelIOError(std::format("Model file {} is truncated", filename));
+    }
+    preprocessor = std::move(loadedPreprocessor);
+    embeddings = std::move(loadedEmbeddings);
+    layers = std::move(loadedLayers);
+}
+
+// Write a self-contained C++ header with the weights as constexpr arrays and an inline predict function specialized for
+// this topology, so the model can be embedded into another binary without linking this library or reading a model file
+void MLP::exportHeader(const std::string &filename, const std::string &modelName) const {
+    if (layers.size() < 2) {
+        throw EmptyNetwork("Network must have at least two layers (input and output) to be exported.");
+    }
+    auto isIdentifierChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_'; };
+    if (modelName.empty() || std::isdigit(static_cast<unsigned char>(modelName.front())) != 0 ||
+        !std::ranges::all_of(modelName, isIdentifierChar)) {
+        throw std::invalid_argument("Model name must be a valid C++ identifier: " + modelName);
+    }
+
+    if (!embeddings.empty()) {
+        throw std::invalid_argument("Networks with embeddings cannot be exported");
+    }
+
+    std::vector<std::string> activations;
+    for (std::size_t l = 1; l < layers.size(); ++l) {
+        if (layers[l].isNormalized()) {
+            throw std::invalid_argument(std::format("Layer {} uses normalization, which cannot be exported", l));
+        }
+        std::string name = activationName(layers[l].getActivationFunction());
+        if (name.empty()) {
+            throw std::invalid_argument(std::format("Layer {} uses a custom activation function, only the ones "
+                                                    "defined in utils.h can be exported",
+                                                    l));
+        }
+        activations.push_back(name);
+    }
+
+    std::ofstream file(filename);
+    if (!file) {
+        throw ModelIOError("Unable to open file for exporting: " + filename);
+    }
+
+    std::string guard = modelName + "_H";
+    std::ranges::transform(guard, guard.begin(), [](char c) { return std::toupper(static_cast<unsigned char>(c)); });
+    std::size_t numInputs = layers.front().getNeurons().size();
+    std::size_t numOutputs = layers.back().getNeurons().size();
+
+    // max_digits10 guarantees every weight round-trips to the exact same double
+    file << std::setprecision(std::numeric_limits<double>::max_digits10);
+    file << "// Generated by mlp.cpp, do not edit\n"
+         << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+         << "#include <algorithm>\n#include <array>\n#include <cmath>\n#include <cstddef>\n\n"
+         << "namespace " << modelName << " {\n\n"
+         << "inline constexpr std::size_t kInputs = " << numInputs << ";\n"
+         << "inline constexpr std::size_t kOutputs = " << numOutputs << ";\n\n"
+         << "namespace detail {\n"
+         << "inline double sigmoid(double x) { return 1.0 / (1.0 + std::exp(-x)); }\n"
+         << "inline double tanh(double x) { return std::tanh(x); }\n"
+         << "inline double relu(double x) { return std::max(0.0, x); }\n"
+         << "inline double identity(double x) { return x; }\n\n";
+
+    // The affine part of the preprocessing is folded into the first layer, so it costs nothing at inference
+    for (std::size_t l = 1; l < layers.size(); ++l) {
+        const auto &neurons = layers[l].getNeurons();
+        std::size_t layerInputs = layers[l - 1].getNeurons().size();
+        std::vector<double> biases;
+        file << "inline constexpr double kWeights" << l << "[" << neurons.size() << "][" << layerInputs << "] = {\n";
+        for (const auto &neuron : neurons) {
+            std::vector<double> weights = neuron.getWeights();
+            double bias = neuron.getBias();
+            if (l == 1) {
+                preprocessor.foldInto(weights, bias);
+            }
+            biases.push_back(bias);
+            file << "    {";
+            for (std::size_t w = 0; w < weights.size(); ++w) {
+                if (!std::isfinite(weights[w])) {
+                    throw std::invalid_argument(std::format("Layer {} contains non-finite weights", l));
+                }
+                file << (w == 0 ? "" : ", ") << weights[w];
+            }
+            file << "},\n";
+        }
+        file << "};\n";
+        file << "inline constexpr double kBias" << l << "[" << neurons.size() << "] = {";
+        for (std::size_t n = 0; n < biases.size(); ++n) {
+            file << (n == 0 ? "" : ", ") << biases[n];
+        }
+        file << "};\n\n";
+    }
+    file << "} // namespace detail\n\n";
+
+    // The accumulation order mirrors Neuron::calculatePreOutput so results match MLP::predict
+    file << "inline std::array<double, kOutputs> predict(const std::array<double, kInputs> &input) {\n";
+    const auto &transforms = preprocessor.getTransforms();
+    if (std::ranges::find(transforms, FeatureTransform::Log) == transforms.end()) {
+        file << "    const double *in = input.data();\n";
+    } else {
+        file << "    std::array<double, kInputs> features = input;\n";
+        for (std::size_t f = 0; f < transforms.size(); ++f) {
+            if (transforms[f] == FeatureTransform::Log) {
+                file << "    features[" << f << "] = std::log1p(std::max(features[" << f << "], 0.0));\n";
+            }
+        }
+        file << "    const double *in = features.data();\n";
+    }
+    for (std::size_t l = 1; l < layers.size(); ++l) {
+        std::size_t size = layers[l].getNeurons().size();
+        std::size_t layerInputs = layers[l - 1].getNeurons().size();
+        file << "    std::array<double, " << size << "> layer" << l << "{};\n"
+             << "    for (std::size_t i = 0; i < " << size << "; ++i) {\n"
+             << "        double sum = detail::kBias" << l << "[i];\n"
+             << "        for (std::size_t j = 0; j < " << layerInputs << "; ++j) {\n"
+             << "            sum += in[j] * detail::kWeights" << l << "[i][j];\n"
+             << "        }\n"
+             << "        layer" << l << "[i] = detail::" << activations[l - 1] << "(sum);\n"
+             << "    }\n";
+        if (l + 1 < layers.size()) {
+            file << "    in = layer" << l << ".data();\n";
+        }
+    }
+    std::string last = "layer" + std::to_string(layers.size() - 1);
+    if (softmax) {
+        file << "    double sumOfExponentials = 0.0;\n"
+             << "    for (double value : " << last << ") {\n"
+             << "        sumOfExponentials += std::exp(value);\n"
+             << "    }\n"
+             << "    for (double &value : " << last << ") {\n"
+             << "        value = std::exp(value) / sumOfExponentials;\n"
+             << "    }\n";
+    }
+    file << "    return " << last << ";\n}\n\n"
+         << "} // namespace " << modelName << "\n\n#endif // " << guard << "\n";
+
+    if (!file) {
+        throw ModelIOError("Error while writing exported model: " + filename);
+    }
+}
@@ -1,7 +1,11 @@
 #include "neuron.h"
+#include "counter_rng.h"
+#include "sparse_vector.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <numeric>
@@ -19,6 +23,8 @@ double Neuron::getOutput() const noexcept { return output; }
 
 double Neuron::getGradient() const noexcept { return gradient; }
 
+double Neuron::getBias() const noexcept { return bias; }
+
 const std::vector<double> &Neuron::getWeights() const noexcept { return weights; }
 
 const std::vector<double> &Neuron::getInputs() const noexcept { return inputs; }
@@ -28,7 +34,7 @@ void Neuron::setInputs(std::vector<double> newInputs, bool initWeights) {
     if (initWeights) {
         initializeWeights(newInputs.size());
     } else {
-        if (newInputs.size() != inputs.size()) {
+        if (newInputs.size() != weights.size()) {
             throw std::invalid_argument("Mismatch in number of inputs");
         }
     }
@@ -48,23 +54,73 @@ void Neuron::setGradient(double newGradient) {
     gradient = std::clamp(newGradient, -10.0, 10.0); // Gradient clipping
 }
 
-// Initialize the weights using He initialization
+// Initialize the weights of a standalone neuron, each call draws from a different stream so neurons never share
+// weights. Networks use the keyed overload instead, which does not depend on the order neurons are created in.
 void Neuron::initializeWeights(size_t numInputs) {
+    static const std::uint64_t processSeed = std::random_device{}();
+    static std::atomic<std::uint64_t> nextStream{0};
+    initializeWeights(numInputs, constantWeightInit ? 42 : processSeed, nextStream.fetch_add(1));
+}
+
+// Initialize the weights using He initialization, drawing from the given stream of a counter-based generator so the
+// result is the same whichever thread does it
+void Neuron::initializeWeights(size_t numInputs, std::uint64_t seed, std::uint64_t stream) {
     if (numInputs == 0) {
         return;
     }
     weights.resize(numInputs);
     double variance = 2.0 / static_cast<double>(numInputs);
     double stddev = std::sqrt(variance);
-    static unsigned seed = constantWeightInit ? 42 : std::random_device{}();
-    static std::mt19937 gen(seed);
-    std::uniform_real_distribution dis(0.0, stddev);
-    std::ranges::generate(weights, [&]() { return dis(gen); });
+    CounterRng rng(seed, stream);
+    for (std::size_t i = 0; i < numInputs; ++i) {
+        weights[i] = rng.uniform(i) * stddev;
+    }
 }
 
 // Calculate the pre-output of the neuron by taking the dot product of the inputs and weights and adding the bias
 double Neuron::calculatePreOutput() { return std::inner_product(inputs.begin(), inputs.end(), weights.begin(), bias); }
 
+// Same for inputs given as a sparse vector, only the weights of the nonzero inputs are read
+double Neuron::calculatePreOutput(const SparseVector &sparseInputs) const {
+    double sum = bias;
+    for (std::size_t k = 0; k < sparseInputs.indices.size(); ++k) {
+        sum += sparseInputs.values[k] * weights[sparseInputs.indices[k]];
+    }
+    return sum;
+}
+
+// Gradient step on the weights of the nonzero inputs, the gradient of the others is zero
+void Neuron::updateWeights(const SparseVector &sparseInputs, double step) {
+    for (std::size_t k = 0; k < sparseInputs.indices.size(); ++k) {
+        weights[sparseInputs.indices[k]] -= step * sparseInputs.values[k];
+    }
+}
+
+// Zero every weight outside the kept columns in place and copy the kept weights to keptValues
+void Neuron::maskWeights(const std::uint32_t *keptColumns, std::size_t numKept, double *keptValues) noexcept {
+    for (std::size_t k = 0; k < numKept; ++k) {
+        keptValues[k] = weights[keptColumns[k]];
+    }
+    std::ranges::fill(weights, 0.0);
+    for (std::size_t k = 0; k < numKept; ++k) {
+        weights[keptColumns[k]] = keptValues[k];
+    }
+}
+
+// Same as above when only the weights of the touched columns changed, the kept columns must be in increasing order
+void Neuron::maskWeights(const SparseVector &touched, const std::uint32_t *keptColumns, std::size_t numKept,
+                         double *keptValues) noexcept {
+    const std::uint32_t *keptEnd = keptColumns + numKept;
+    for (std::uint32_t column : touched.indices) {
+        const std::uint32_t *kept = std::lower_bound(keptColumns, keptEnd, column);
+        if (kept != keptEnd && *kept == column) {
+            keptValues[kept - keptColumns] = weights[column];
+        } else {
+            weights[column] = 0.0;
+        }
+    }
+}
+
 // Save the number of weights and the weights themselves to the output stream
 void Neuron::save(std::ofstream &out) const {
     std::size_t numWeights = weights.size();
@@ -0,0 +1,117 @@
+#include "numa_topology.h"
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+// Parse a sysfs CPU list such as "0-3,8,10-11"
+std::vector<unsigned> parseCpuList(const std::string &list) {
+    std::vector<unsigned> cpus;
+    std::istringstream listStream(list);
+    std::string range;
+    while (std::getline(listStream, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        std::size_t dash = range.find('-');
+        auto first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+        auto last = dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+        for (unsigned cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+} // namespace
+
+NumaTopology::NumaTopology(const std::string &sysfsNodeDir) {
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(sysfsNodeDir, error)) {
+        std::string name = entry.path().filename().string();
+        if (!name.starts_with("node") || name.size() == 4 ||
+            !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        std::size_t node = std::stoul(name.substr(4));
+        std::ifstream cpuListFile(entry.path() / "cpulist");
+        std::string cpuList;
+        std::getline(cpuListFile, cpuList);
+        if (nodeCpus.size() <= node) {
+            nodeCpus.resize(node + 1);
+        }
+        nodeCpus[node] = parseCpuList(cpuList);
+    }
+
+    // Memory-only nodes have no CPUs and cannot run inference threads
+    std::erase_if(nodeCpus, [](const std::vector<unsigned> &cpus) { return cpus.empty(); });
+    if (nodeCpus.empty()) {
+        nodeCpus.emplace_back();
+        for (unsigned cpu = 0; cpu < std::max(1U, std::thread::hardware_concurrency()); ++cpu) {
+            nodeCpus.back().push_back(cpu);
+        }
+    }
+
+    for (std::size_t node = 0; node < nodeCpus.size(); ++node) {
+        for (unsigned cpu : nodeCpus[node]) {
+            if (cpuNodes.size() <= cpu) {
+                cpuNodes.resize(cpu + 1, 0);
+            }
+            cpuNodes[cpu] = node;
+        }
+    }
+}
+
+// Topology of the running host, parsed once
+const NumaTopology &NumaTopology::system() {
+    static const NumaTopology topology;
+    return topology;
+}
+
+std::size_t NumaTopology::numNodes() const noexcept { return nodeCpus.size(); }
+
+const std::vector<unsigned> &NumaTopology::cpusOfNode(std::size_t node) const {
+    if (node >= nodeCpus.size()) {
+        throw std::out_of_range(std::format("NUMA node {} does not exist, there are {} nodes", node, nodeCpus.size()));
+    }
+    return nodeCpus[node];
+}
+
+std::size_t NumaTopology::nodeOfCpu(unsigned cpu) const noexcept { return cpu < cpuNodes.size() ? cpuNodes[cpu] : 0; }
+
+// Node of the CPU the calling thread is running on right now
+std::size_t NumaTopology::currentNode() const noexcept {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return nodeOfCpu(static_cast<unsigned>(cpu));
+    }
+#endif
+    return 0;
+}
+
+// Restrict the calling thread to the CPUs of a node, so the memory it touches first is allocated on that node
+bool NumaTopology::bindCurrentThreadToNode(std::size_t node) const {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpusOfNode(node)) {
+        CPU_SET(cpu, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
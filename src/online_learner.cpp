@@ -0,0 +1,84 @@
+#include "online_learner.h"
+#include "bfloat16.h"
+#include "mlp.h"
+#include "packed_model.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+OnlineLearner::OnlineLearner(MLP mlp, std::size_t publishInterval, WeightPrecision precision)
+    : mlp(std::move(mlp)), publishInterval(std::max<std::size_t>(1, publishInterval)), precision(precision) {
+    publishLocked();
+}
+
+std::shared_ptr<const OnlineLearner::Snapshot> OnlineLearner::current() const noexcept {
+    return served.load(std::memory_order_acquire);
+}
+
+std::uint64_t OnlineLearner::version() const noexcept { return current()->version; }
+
+// The snapshot is kept alive until the prediction ends even if a newer one is published meanwhile
+std::vector<double> OnlineLearner::predict(const std::vector<double> &input) const {
+    return current()->model.predict(input);
+}
+
+void OnlineLearner::update(const std::vector<double> &input, const std::vector<double> &target) {
+    std::scoped_lock lock(updateMutex);
+    train(input, target);
+}
+
+void OnlineLearner::update(const std::vector<std::vector<double>> &inputData,
+                           const std::vector<std::vector<double>> &targetData) {
+    if (inputData.size() != targetData.size()) {
+        throw std::invalid_argument("Input data and target data must have the same number of entries.");
+    }
+    std::scoped_lock lock(updateMutex);
+    for (std::size_t i = 0; i < inputData.size(); ++i) {
+        train(inputData[i], targetData[i]);
+    }
+}
+
+// Publish the updates made since the last snapshot without waiting for the interval
+void OnlineLearner::publish() {
+    std::scoped_lock lock(updateMutex);
+    if (pendingUpdates > 0) {
+        publishLocked();
+    }
+}
+
+// Saves the latest weights, including the updates that have not been published yet
+void OnlineLearner::save(const std::string &filename, WeightPrecision savePrecision) {
+    std::scoped_lock lock(updateMutex);
+    mlp.save(filename, savePrecision);
+}
+
+void OnlineLearner::train(const std::vector<double> &input, const std::vector<double> &target) {
+    const Preprocessor &preprocessor = mlp.getPreprocessor();
+    mlp.feedForward(preprocessor.empty() ? input : preprocessor.transform(input));
+    mlp.backPropagate(target);
+    if (++pendingUpdates >= publishInterval) {
+        publishLocked();
+    }
+}
+
+// A snapshot may be replaced after every update, so it is built on regular pages with a single replica, which is much
+// cheaper than reserving huge pages on every node
+void OnlineLearner::publishLocked() {
+    auto snapshot =
+        std::make_shared<const Snapshot>(Snapshot{nextVersion++, PackedModel(mlp, false, false, precision)});
+    std::shared_ptr<const Snapshot> previous = served.exchange(std::move(snapshot), std::memory_order_acq_rel);
+    pendingUpdates = 0;
+
+    // A replaced snapshot can no longer be loaded, so once only this list holds it no reader will ever use it again
+    std::erase_if(retired, [](const auto &snapshot) { return snapshot.use_count() == 1; });
+    if (previous) {
+        retired.push_back(std::move(previous));
+    }
+}
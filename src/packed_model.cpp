@@ -0,0 +1,345 @@
+#include "packed_model.h"
+#include "bfloat16.h"
+#include "huge_page_buffer.h"
+#include "layer.h"
+#include "mlp.h"
+#include "numa_topology.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <format>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Rows [rowBegin, rowEnd) of a dense layer on a batch, Rows rows at a time. Each sample is read once per block of rows
+// and the block keeps Rows independent sums in flight, while every sum still adds its terms in the same order.
+template <std::size_t Rows>
+std::size_t denseRows(const double *weights, const double *biases, std::size_t inputs, std::size_t outputs,
+                      std::size_t rowBegin, std::size_t rowEnd, const double *current, double *next,
+                      std::size_t batchSize, const std::function<double(double)> &activation) {
+    std::size_t n = rowBegin;
+    for (; n + Rows <= rowEnd; n += Rows) {
+        for (std::size_t b = 0; b < batchSize; ++b) {
+            const double *sample = current + b * inputs;
+            std::array<double, Rows> sums{};
+            for (std::size_t r = 0; r < Rows; ++r) {
+                sums[r] = biases[n + r];
+            }
+            for (std::size_t i = 0; i < inputs; ++i) {
+                for (std::size_t r = 0; r < Rows; ++r) {
+                    sums[r] += sample[i] * weights[(n + r) * inputs + i];
+                }
+            }
+            for (std::size_t r = 0; r < Rows; ++r) {
+                next[b * outputs + n + r] = activation(sums[r]);
+            }
+        }
+    }
+    return n;
+}
+
+} // namespace
+
+PackedModel::PackedModel(const MLP &mlp, bool hugePages, bool replicatePerNode, WeightPrecision precision)
+    : softmax(mlp.usesSoftmax()), precision(precision) {
+    const auto &mlpLayers = mlp.getLayers();
+    if (mlpLayers.size() < 2) {
+        throw std::invalid_argument("Network must have at least two layers (input and output) to be packed.");
+    }
+
+    if (!mlp.getEmbeddings().empty()) {
+        throw std::invalid_argument("Networks with embeddings cannot be packed.");
+    }
+    inputs = mlpLayers.front().getNeurons().size();
+    maxWidth = inputs;
+    const auto &transforms = mlp.getPreprocessor().getTransforms();
+    for (std::size_t f = 0; f < transforms.size(); ++f) {
+        if (transforms[f] == FeatureTransform::Log) {
+            logFeatures.push_back(f);
+        }
+    }
+    std::size_t numWeights = 0;
+    std::size_t numBiases = 0;
+    for (std::size_t l = 1; l < mlpLayers.size(); ++l) {
+        if (mlpLayers[l].isNormalized()) {
+            throw std::invalid_argument(std::format("Layer {} uses normalization, which cannot be packed", l));
+        }
+        PackedLayer layer;
+        layer.inputs = mlpLayers[l - 1].getNeurons().size();
+        layer.outputs = mlpLayers[l].getNeurons().size();
+        layer.weightsOffset = numWeights;
+        layer.biasOffset = numBiases;
+        layer.activationFunction = mlpLayers[l].getActivationFunction();
+        numWeights += layer.inputs * layer.outputs;
+        numBiases += layer.outputs;
+        maxWidth = std::max(maxWidth, layer.outputs);
+        layers.push_back(std::move(layer));
+    }
+    parameters = numWeights + numBiases;
+    weightsBase = numBiases;
+    // Four bfloat16 weights fit in the space of a double
+    std::size_t bufferSize = numBiases + (precision == WeightPrecision::Bfloat16 ? (numWeights + 3) / 4 : numWeights);
+
+    // Each replica is allocated and filled by a thread bound to its node, so first-touch places its pages there
+    auto fillReplica = [&](HugePageBuffer &replica) {
+        replica = HugePageBuffer(bufferSize, hugePages);
+        double *data = replica.data();
+        auto *bfloat16Weights = reinterpret_cast<std::uint16_t *>(data + weightsBase);
+        for (std::size_t l = 1; l < mlpLayers.size(); ++l) {
+            const PackedLayer &layer = layers[l - 1];
+            const auto &neurons = mlpLayers[l].getNeurons();
+            for (std::size_t n = 0; n < neurons.size(); ++n) {
+                // The affine part of the preprocessing is folded into the first layer
+                std::vector<double> weights = neurons[n].getWeights();
+                double bias = neurons[n].getBias();
+                if (l == 1) {
+                    mlp.getPreprocessor().foldInto(weights, bias);
+                }
+                std::size_t rowOffset = layer.weightsOffset + n * layer.inputs;
+                if (precision == WeightPrecision::Bfloat16) {
+                    std::ranges::transform(weights, bfloat16Weights + rowOffset, toBfloat16);
+                } else {
+                    std::ranges::copy(weights, data + weightsBase + rowOffset);
+                }
+                data[layer.biasOffset + n] = bias;
+            }
+        }
+    };
+
+    const NumaTopology &topology = NumaTopology::system();
+    std::size_t numNodes = replicatePerNode ? topology.numNodes() : 1;
+    replicas.resize(numNodes);
+    if (numNodes == 1) {
+        fillReplica(replicas.front());
+        return;
+    }
+
+    std::exception_ptr error;
+    for (std::size_t node = 0; node < numNodes; ++node) {
+        std::thread([&, node]() {
+            try {
+                topology.bindCurrentThreadToNode(node);
+                fillReplica(replicas[node]);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }).join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::size_t PackedModel::numInputs() const noexcept { return inputs; }
+
+std::size_t PackedModel::numOutputs() const noexcept { return layers.back().outputs; }
+
+std::size_t PackedModel::numParameters() const noexcept { return parameters; }
+
+std::size_t PackedModel::numReplicas() const noexcept { return replicas.size(); }
+
+PageBacking PackedModel::pageBacking() const noexcept { return replicas.front().backing(); }
+
+WeightPrecision PackedModel::weightPrecision() const noexcept { return precision; }
+
+// Number of neurons of every layer, starting with the inputs
+std::vector<std::size_t> PackedModel::layerSizes() const {
+    std::vector<std::size_t> sizes{inputs};
+    for (const PackedLayer &layer : layers) {
+        sizes.push_back(layer.outputs);
+    }
+    return sizes;
+}
+
+const KernelConfig &PackedModel::kernelConfig() const noexcept { return config; }
+
+// Must not be called while predictions are running, the threads of the previous configuration are stopped
+void PackedModel::setKernelConfig(const KernelConfig &newConfig) {
+    if (newConfig.rowBlock != 1 && newConfig.rowBlock != 2 && newConfig.rowBlock != 4 && newConfig.rowBlock != 8) {
+        throw std::invalid_argument(std::format("Row block must be 1, 2, 4 or 8, got {}", newConfig.rowBlock));
+    }
+    std::size_t numThreads = std::max<std::size_t>(1, newConfig.numThreads);
+    if (numThreads != config.numThreads) {
+        threadPool = numThreads > 1 ? std::make_shared<ThreadPool>(numThreads) : nullptr;
+    }
+    config = newConfig;
+    config.numThreads = numThreads;
+}
+
+// Replica on the NUMA node of the CPU the calling thread is running on
+const HugePageBuffer &PackedModel::localReplica() const noexcept {
+    if (replicas.size() == 1) {
+        return replicas.front();
+    }
+    return replicas[std::min(NumaTopology::system().currentNode(), replicas.size() - 1)];
+}
+
+std::vector<double> PackedModel::predict(const std::vector<double> &input) const {
+    if (input.size() != inputs) {
+        throw std::invalid_argument(
+            std::format("Mismatch in number of inputs provided, expected {}, got {}", inputs, input.size()));
+    }
+
+    if (precision == WeightPrecision::Bfloat16) {
+        thread_local std::vector<float> current;
+        thread_local std::vector<float> next;
+        current.resize(std::max(current.size(), maxWidth));
+        next.resize(std::max(next.size(), maxWidth));
+        std::ranges::copy(input, current.begin());
+        applyLogFeatures(current.data());
+        forwardBfloat16(current, next, 1);
+        std::vector<double> output(current.begin(), current.begin() + static_cast<std::ptrdiff_t>(numOutputs()));
+        applySoftmax(output);
+        return output;
+    }
+
+    // Per-thread activation buffers, so concurrent predictions neither allocate nor share state
+    thread_local std::vector<double> current;
+    thread_local std::vector<double> next;
+    current.resize(std::max(current.size(), maxWidth));
+    next.resize(std::max(next.size(), maxWidth));
+    std::ranges::copy(input, current.begin());
+    applyLogFeatures(current.data());
+
+    forwardDouble(current, next, 1);
+
+    std::vector<double> output(current.begin(), current.begin() + static_cast<std::ptrdiff_t>(numOutputs()));
+    applySoftmax(output);
+    return output;
+}
+
+// Predict several samples at once. Each row of weights is loaded once and applied to a whole tile of samples, which
+// makes much better use of the caches than predicting the samples one by one. The tiles are split across the threads
+// of the kernel configuration. Results are identical to predict.
+std::vector<std::vector<double>> PackedModel::predictBatch(const std::vector<std::vector<double>> &batch) const {
+    for (const auto &input : batch) {
+        if (input.size() != inputs) {
+            throw std::invalid_argument(
+                std::format("Mismatch in number of inputs provided, expected {}, got {}", inputs, input.size()));
+        }
+    }
+
+    std::vector<std::vector<double>> outputs(batch.size());
+    auto predictRange = [&](std::size_t begin, std::size_t end) {
+        std::size_t tile = config.sampleTile == 0 ? end - begin : config.sampleTile;
+        for (std::size_t first = begin; first < end; first += tile) {
+            if (precision == WeightPrecision::Bfloat16) {
+                predictTile<float>(batch, first, std::min(end, first + tile), outputs);
+            } else {
+                predictTile<double>(batch, first, std::min(end, first + tile), outputs);
+            }
+        }
+    };
+    if (threadPool) {
+        threadPool->parallelFor(batch.size(), predictRange);
+    } else {
+        predictRange(0, batch.size());
+    }
+    return outputs;
+}
+
+// Samples [begin, end) of the batch, with activations of type T in per-thread buffers holding one sample after the
+// other
+template <typename T>
+void PackedModel::predictTile(const std::vector<std::vector<double>> &batch, std::size_t begin, std::size_t end,
+                              std::vector<std::vector<double>> &outputs) const {
+    std::size_t tileSize = end - begin;
+    thread_local std::vector<T> current;
+    thread_local std::vector<T> next;
+    current.resize(std::max(current.size(), maxWidth * tileSize));
+    next.resize(std::max(next.size(), maxWidth * tileSize));
+    for (std::size_t b = 0; b < tileSize; ++b) {
+        std::ranges::copy(batch[begin + b], current.begin() + static_cast<std::ptrdiff_t>(b * inputs));
+        applyLogFeatures(current.data() + b * inputs);
+    }
+    if constexpr (std::is_same_v<T, float>) {
+        forwardBfloat16(current, next, tileSize);
+    } else {
+        forwardDouble(current, next, tileSize);
+    }
+
+    for (std::size_t b = 0; b < tileSize; ++b) {
+        auto first = current.begin() + static_cast<std::ptrdiff_t>(b * numOutputs());
+        outputs[begin + b].assign(first, first + static_cast<std::ptrdiff_t>(numOutputs()));
+        applySoftmax(outputs[begin + b]);
+    }
+}
+
+// Evaluate the layers on batchSize samples stored one after the other in current, which holds the outputs at the end.
+// Every sum has the same accumulation order as Neuron::calculatePreOutput whatever the row block.
+void PackedModel::forwardDouble(std::vector<double> &current, std::vector<double> &next, std::size_t batchSize) const {
+    const double *data = localReplica().data();
+    for (const PackedLayer &layer : layers) {
+        const double *weights = data + weightsBase + layer.weightsOffset;
+        const double *biases = data + layer.biasOffset;
+        std::size_t done = 0;
+        auto rows = [&]<std::size_t Rows>() {
+            done = denseRows<Rows>(weights, biases, layer.inputs, layer.outputs, done, layer.outputs, current.data(),
+                                   next.data(), batchSize, layer.activationFunction);
+        };
+        // Rows left over by a block go through the smaller ones
+        switch (config.rowBlock) {
+        case 8:
+            rows.template operator()<8>();
+            [[fallthrough]];
+        case 4:
+            rows.template operator()<4>();
+            [[fallthrough]];
+        case 2:
+            rows.template operator()<2>();
+            [[fallthrough]];
+        default:
+            rows.template operator()<1>();
+        }
+        std::swap(current, next);
+    }
+}
+
+// Evaluate the layers on batchSize samples stored one after the other in current, which holds the outputs at the end.
+// Each row of bfloat16 weights is widened on the fly and accumulated in float, the biases are added in double.
+void PackedModel::forwardBfloat16(std::vector<float> &current, std::vector<float> &next, std::size_t batchSize) const {
+    const double *data = localReplica().data();
+    const auto *weights = reinterpret_cast<const std::uint16_t *>(data + weightsBase);
+    for (const PackedLayer &layer : layers) {
+        for (std::size_t n = 0; n < layer.outputs; ++n) {
+            const std::uint16_t *row = weights + layer.weightsOffset + n * layer.inputs;
+            for (std::size_t b = 0; b < batchSize; ++b) {
+                double sum = data[layer.biasOffset + n] +
+                             dotBfloat16(row, current.data() + b * layer.inputs, layer.inputs);
+                next[b * layer.outputs + n] = static_cast<float>(layer.activationFunction(sum));
+            }
+        }
+        std::swap(current, next);
+    }
+}
+
+// The only part of the preprocessing that cannot be folded into the weights
+template <typename T> void PackedModel::applyLogFeatures(T *sample) const {
+    for (std::size_t feature : logFeatures) {
+        sample[feature] = static_cast<T>(std::log1p(std::max(static_cast<double>(sample[feature]), 0.0)));
+    }
+}
+
+void PackedModel::applySoftmax(std::vector<double> &output) const {
+    if (!softmax) {
+        return;
+    }
+    double sumOfExponentials = 0.0;
+    for (double value : output) {
+        sumOfExponentials += std::exp(value);
+    }
+    for (double &value : output) {
+        value = std::exp(value) / sumOfExponentials;
+    }
+}
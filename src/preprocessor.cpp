@@ -0,0 +1,191 @@
+#include "preprocessor.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Rows per block of the statistics pass. Blocks are merged in order, so the statistics do not depend on the number of
+// threads that computed them.
+constexpr std::size_t kStatsBlockSize = 1024;
+
+double nonAffine(FeatureTransform transform, double value) {
+    return transform == FeatureTransform::Log ? std::log1p(std::max(value, 0.0)) : value;
+}
+
+// Running statistics of one feature, blocks are combined with the pairwise update of Chan et al.
+struct FeatureStats {
+    double count{0.0};
+    double mean{0.0};
+    double m2{0.0};
+    double min{std::numeric_limits<double>::infinity()};
+    double max{-std::numeric_limits<double>::infinity()};
+
+    void add(double value) {
+        count += 1.0;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void merge(const FeatureStats &other) {
+        if (other.count == 0.0) {
+            return;
+        }
+        double total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count = total;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+} // namespace
+
+bool Preprocessor::empty() const noexcept { return transforms.empty(); }
+
+std::size_t Preprocessor::numFeatures() const noexcept { return transforms.size(); }
+
+const std::vector<FeatureTransform> &Preprocessor::getTransforms() const noexcept { return transforms; }
+
+const std::vector<double> &Preprocessor::getScales() const noexcept { return scales; }
+
+const std::vector<double> &Preprocessor::getOffsets() const noexcept { return offsets; }
+
+// Compute the statistics of every feature in a single pass over the data, split in blocks across the threads of the
+// pool when one is given. Features with no spread are left unscaled.
+void Preprocessor::fit(const std::vector<std::vector<double>> &data, const std::vector<FeatureTransform> &transforms,
+                       ThreadPool *pool) {
+    if (data.empty()) {
+        throw std::invalid_argument("At least one sample is needed to fit a preprocessor.");
+    }
+    std::size_t numFeatures = transforms.size();
+    std::size_t numBlocks = (data.size() + kStatsBlockSize - 1) / kStatsBlockSize;
+    std::vector<std::vector<FeatureStats>> blockStats(numBlocks, std::vector<FeatureStats>(numFeatures));
+
+    auto accumulate = [&](std::size_t beginBlock, std::size_t endBlock) {
+        for (std::size_t block = beginBlock; block < endBlock; ++block) {
+            std::size_t end = std::min(data.size(), (block + 1) * kStatsBlockSize);
+            for (std::size_t row = block * kStatsBlockSize; row < end; ++row) {
+                if (data[row].size() != numFeatures) {
+                    throw std::invalid_argument(std::format("Sample {} has {} features, expected {}", row,
+                                                            data[row].size(), numFeatures));
+                }
+                for (std::size_t f = 0; f < numFeatures; ++f) {
+                    blockStats[block][f].add(nonAffine(transforms[f], data[row][f]));
+                }
+            }
+        }
+    };
+    if (pool == nullptr) {
+        accumulate(0, numBlocks);
+    } else {
+        pool->parallelFor(numBlocks, accumulate);
+    }
+
+    std::vector<double> newScales(numFeatures, 1.0);
+    std::vector<double> newOffsets(numFeatures, 0.0);
+    for (std::size_t f = 0; f < numFeatures; ++f) {
+        FeatureStats stats;
+        for (const auto &block : blockStats) {
+            stats.merge(block[f]);
+        }
+        if (transforms[f] == FeatureTransform::MinMax) {
+            double range = stats.max - stats.min;
+            newScales[f] = range > 0.0 ? 1.0 / range : 1.0;
+            newOffsets[f] = -stats.min * newScales[f];
+        } else if (transforms[f] != FeatureTransform::None) {
+            double stddev = std::sqrt(stats.m2 / stats.count);
+            newScales[f] = stddev > 0.0 ? 1.0 / stddev : 1.0;
+            newOffsets[f] = -stats.mean * newScales[f];
+        }
+    }
+
+    this->transforms = transforms;
+    scales = std::move(newScales);
+    offsets = std::move(newOffsets);
+}
+
+// Inputs are returned unchanged while the preprocessor has not been fitted
+std::vector<double> Preprocessor::transform(const std::vector<double> &input) const {
+    if (empty()) {
+        return input;
+    }
+    if (input.size() != transforms.size()) {
+        throw std::invalid_argument(std::format("Mismatch in number of features provided, expected {}, got {}",
+                                                transforms.size(), input.size()));
+    }
+    std::vector<double> output(input.size());
+    for (std::size_t f = 0; f < input.size(); ++f) {
+        output[f] = applyNonAffine(f, input[f]) * scales[f] + offsets[f];
+    }
+    return output;
+}
+
+std::vector<std::vector<double>> Preprocessor::transform(const std::vector<std::vector<double>> &data) const {
+    std::vector<std::vector<double>> output;
+    output.reserve(data.size());
+    for (const auto &input : data) {
+        output.push_back(transform(input));
+    }
+    return output;
+}
+
+// The part of the transform of a feature that comes before the affine step
+double Preprocessor::applyNonAffine(std::size_t feature, double value) const {
+    return nonAffine(transforms[feature], value);
+}
+
+// Fold the affine step into a neuron of the first layer, after which it can be fed the features with only their
+// non-affine part applied: w . (x * scale + offset) + b == (w * scale) . x + (w . offset + b)
+void Preprocessor::foldInto(std::vector<double> &weights, double &bias) const {
+    if (empty()) {
+        return;
+    }
+    if (weights.size() != transforms.size()) {
+        throw std::invalid_argument(std::format("Mismatch in number of weights to fold, expected {}, got {}",
+                                                transforms.size(), weights.size()));
+    }
+    for (std::size_t f = 0; f < weights.size(); ++f) {
+        bias += weights[f] * offsets[f];
+        weights[f] *= scales[f];
+    }
+}
+
+void Preprocessor::save(std::ofstream &out) const {
+    std::size_t count = transforms.size();
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char *>(transforms.data()), sizeof(FeatureTransform) * count);
+    out.write(reinterpret_cast<const char *>(scales.data()), sizeof(double) * count);
+    out.write(reinterpret_cast<const char *>(offsets.data()), sizeof(double) * count);
+}
+
+// The feature count read from the file is checked against what is left of it before anything is allocated from it
+void Preprocessor::load(std::ifstream &in) {
+    std::size_t count;
+    in.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!in || count > remainingBytes(in) / (sizeof(FeatureTransform) + 2 * sizeof(double))) {
+        throw std::runtime_error("Corrupted preprocessor in model file");
+    }
+    transforms.resize(count);
+    scales.resize(count);
+    offsets.resize(count);
+    in.read(reinterpret_cast<char *>(transforms.data()), sizeof(FeatureTransform) * count);
+    in.read(reinterpret_cast<char *>(scales.data()), sizeof(double) * count);
+    in.read(reinterpret_cast<char *>(offsets.data()), sizeof(double) * count);
+    if (!in || std::ranges::any_of(transforms, [](FeatureTransform t) { return t > FeatureTransform::Log; })) {
+        throw std::runtime_error("Corrupted preprocessor in model file");
+    }
+}
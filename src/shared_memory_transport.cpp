@@ -0,0 +1,188 @@
+#include "shared_memory_transport.h"
+#include "spin_wait.h"
+#include "transport.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <fcntl.h>
+#include <format>
+#include <linux/futex.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+
+// Slots per rank, with two of them a rank can fill one while the next rank is still reading the other
+constexpr std::uint32_t kSlots = 2;
+// Sleeps are bounded so the timeout is checked even if no rank ever rings
+constexpr long kMaxSleepNanoseconds = 100'000'000;
+
+// The futexes live in memory shared between processes, so the process-private operations of std::atomic::wait cannot
+// be used for them
+long futex(std::uint32_t &word, int operation, std::uint32_t value, const timespec *timeout) noexcept {
+    return syscall(SYS_futex, &word, operation, value, timeout, nullptr, 0);
+}
+
+struct SegmentHeader {
+    alignas(64) std::uint32_t attached;
+};
+
+} // namespace
+
+// Counters of the slots owned by one rank, each on its own cache line since they are written by different processes
+struct SharedMemoryTransport::Mailbox {
+    alignas(64) std::uint32_t doorbell; // bumped whenever the owner may be able to make progress
+    alignas(64) std::uint32_t written;  // pieces written by the owner
+    alignas(64) std::uint32_t consumed; // pieces read by the next rank
+};
+
+SharedMemoryTransport::SharedMemoryTransport(const std::string &name, std::size_t rank, std::size_t size,
+                                             std::chrono::milliseconds timeout, std::size_t slotCapacity)
+    : workerRank(rank), worldSize(size), slotCapacity(slotCapacity), timeout(timeout) {
+    if (rank >= size) {
+        throw std::invalid_argument(std::format("Rank {} is not part of a job of {} workers", rank, size));
+    }
+    if (slotCapacity == 0) {
+        throw std::invalid_argument("Slot capacity must be at least one value.");
+    }
+    if (name.size() < 2 || name.front() != '/' || name.find('/', 1) != std::string::npos) {
+        throw std::invalid_argument("Shared memory names must start with a single '/': " + name);
+    }
+
+    // The segment starts zeroed, which is the initial state of every counter
+    bytes = sizeof(SegmentHeader) + size * sizeof(Mailbox) + size * kSlots * slotCapacity * sizeof(double);
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Unable to open shared memory " + name);
+    }
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "Unable to size shared memory " + name);
+    }
+    memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        memory = nullptr;
+        throw std::system_error(errno, std::generic_category(), "Unable to map shared memory " + name);
+    }
+
+    // Wait for every rank to attach, after which the name is no longer needed
+    try {
+        std::uint32_t &attached = static_cast<SegmentHeader *>(memory)->attached;
+        std::atomic_ref(attached).fetch_add(1, std::memory_order_acq_rel);
+        futex(attached, FUTEX_WAKE, INT_MAX, nullptr);
+        auto lastProgress = std::chrono::steady_clock::now();
+        std::uint32_t seen = std::atomic_ref(attached).load(std::memory_order_acquire);
+        while (seen < size) {
+            waitFor(attached, seen, lastProgress);
+            std::uint32_t current = std::atomic_ref(attached).load(std::memory_order_acquire);
+            if (current != seen) {
+                lastProgress = std::chrono::steady_clock::now();
+                seen = current;
+            }
+        }
+    } catch (...) {
+        munmap(memory, bytes);
+        throw;
+    }
+    shm_unlink(name.c_str()); // only the first rank to get here succeeds
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    if (memory != nullptr) {
+        munmap(memory, bytes);
+    }
+}
+
+std::size_t SharedMemoryTransport::rank() const noexcept { return workerRank; }
+
+std::size_t SharedMemoryTransport::size() const noexcept { return worldSize; }
+
+// Messages are cut in pieces of one slot. Sending and receiving are interleaved piece by piece, so every rank can
+// send at the same time without waiting for each other.
+void SharedMemoryTransport::exchange(const double *send, std::size_t sendCount, double *receive,
+                                     std::size_t receiveCount) {
+    std::size_t next = (workerRank + 1) % worldSize;
+    std::size_t previous = (workerRank + worldSize - 1) % worldSize;
+    Mailbox &outgoing = mailbox(workerRank);
+    Mailbox &incoming = mailbox(previous);
+    std::size_t sendPieces = (sendCount + slotCapacity - 1) / slotCapacity;
+    std::size_t receivePieces = (receiveCount + slotCapacity - 1) / slotCapacity;
+
+    std::size_t sent = 0;
+    std::size_t received = 0;
+    auto lastProgress = std::chrono::steady_clock::now();
+    while (sent < sendPieces || received < receivePieces) {
+        std::uint32_t bell = std::atomic_ref(outgoing.doorbell).load(std::memory_order_acquire);
+        bool progress = false;
+        if (sent < sendPieces) {
+            std::uint32_t written = std::atomic_ref(outgoing.written).load(std::memory_order_relaxed);
+            if (written - std::atomic_ref(outgoing.consumed).load(std::memory_order_acquire) < kSlots) {
+                std::size_t offset = sent * slotCapacity;
+                std::copy_n(send + offset, std::min(slotCapacity, sendCount - offset), slot(workerRank, written));
+                std::atomic_ref(outgoing.written).store(written + 1, std::memory_order_release);
+                ring(next);
+                ++sent;
+                progress = true;
+            }
+        }
+        if (received < receivePieces) {
+            std::uint32_t consumed = std::atomic_ref(incoming.consumed).load(std::memory_order_relaxed);
+            if (std::atomic_ref(incoming.written).load(std::memory_order_acquire) != consumed) {
+                std::size_t offset = received * slotCapacity;
+                std::copy_n(slot(previous, consumed), std::min(slotCapacity, receiveCount - offset), receive + offset);
+                std::atomic_ref(incoming.consumed).store(consumed + 1, std::memory_order_release);
+                ring(previous);
+                ++received;
+                progress = true;
+            }
+        }
+        if (progress) {
+            lastProgress = std::chrono::steady_clock::now();
+        } else {
+            waitFor(outgoing.doorbell, bell, lastProgress);
+        }
+    }
+}
+
+SharedMemoryTransport::Mailbox &SharedMemoryTransport::mailbox(std::size_t owner) const noexcept {
+    return reinterpret_cast<Mailbox *>(static_cast<char *>(memory) + sizeof(SegmentHeader))[owner];
+}
+
+double *SharedMemoryTransport::slot(std::size_t owner, std::uint32_t piece) const noexcept {
+    auto *slots = reinterpret_cast<double *>(static_cast<char *>(memory) + sizeof(SegmentHeader) +
+                                             worldSize * sizeof(Mailbox));
+    return slots + (owner * kSlots + piece % kSlots) * slotCapacity;
+}
+
+// Wake the owner up, it will check again whether it can send or receive
+void SharedMemoryTransport::ring(std::size_t owner) const noexcept {
+    std::uint32_t &doorbell = mailbox(owner).doorbell;
+    std::atomic_ref(doorbell).fetch_add(1, std::memory_order_release);
+    futex(doorbell, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+// Spin for a while and then sleep until the word changes from seen, giving up once the other ranks have made no
+// progress for longer than the timeout
+void SharedMemoryTransport::waitFor(std::uint32_t &word, std::uint32_t seen,
+                                    std::chrono::steady_clock::time_point lastProgress) const {
+    if (spinUntil([&] { return std::atomic_ref(word).load(std::memory_order_acquire) != seen; })) {
+        return;
+    }
+    timespec sleep{0, kMaxSleepNanoseconds};
+    futex(word, FUTEX_WAIT, seen, &sleep);
+    if (timeout.count() > 0 && std::chrono::steady_clock::now() - lastProgress > timeout) {
+        throw std::runtime_error(
+            std::format("Rank {} timed out after {} ms waiting for the other workers", workerRank, timeout.count()));
+    }
+}
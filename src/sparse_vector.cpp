@@ -0,0 +1,40 @@
+#include "sparse_vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <vector>
+
+SparseVector SparseVector::fromDense(const std::vector<double> &dense) {
+    SparseVector sparse;
+    sparse.size = dense.size();
+    for (std::size_t i = 0; i < dense.size(); ++i) {
+        if (dense[i] != 0.0) {
+            sparse.indices.push_back(static_cast<std::uint32_t>(i));
+            sparse.values.push_back(dense[i]);
+        }
+    }
+    return sparse;
+}
+
+std::size_t SparseVector::nonZeros() const noexcept { return indices.size(); }
+
+std::vector<double> SparseVector::toDense() const {
+    std::vector<double> dense(size, 0.0);
+    for (std::size_t k = 0; k < indices.size(); ++k) {
+        if (indices[k] >= size) {
+            throw std::out_of_range(std::format("Sparse index {} out of range for size {}", indices[k], size));
+        }
+        dense[indices[k]] += values[k];
+    }
+    return dense;
+}
+
+// Concatenate other after this vector, its indices are shifted by the current size
+void SparseVector::append(const SparseVector &other) {
+    for (std::size_t k = 0; k < other.indices.size(); ++k) {
+        indices.push_back(static_cast<std::uint32_t>(size + other.indices[k]));
+        values.push_back(other.values[k]);
+    }
+    size += other.size;
+}
@@ -0,0 +1,230 @@
+#include "sweep_trainer.h"
+#include "counter_rng.h"
+#include "mlp.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <format>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// Task queue of one worker, the owner takes tasks from the back and idle workers steal from the front
+class StealingQueue {
+  public:
+    void push(std::size_t task) {
+        std::scoped_lock lock(mutex);
+        tasks.push_back(task);
+    }
+
+    std::optional<std::size_t> pop() {
+        std::scoped_lock lock(mutex);
+        if (tasks.empty()) {
+            return std::nullopt;
+        }
+        std::size_t task = tasks.back();
+        tasks.pop_back();
+        return task;
+    }
+
+    std::optional<std::size_t> steal() {
+        std::scoped_lock lock(mutex);
+        if (tasks.empty()) {
+            return std::nullopt;
+        }
+        std::size_t task = tasks.front();
+        tasks.pop_front();
+        return task;
+    }
+
+  private:
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+};
+
+MLP buildModel(const SweepConfig &config) {
+    if (config.layersNodes.size() < 2) {
+        throw std::invalid_argument("Network must have at least two layers (input and output).");
+    }
+    auto [activationFunc, derivActivationFunc] = activationByName(config.activation);
+    auto [outputActivationFunc, outputDerivActivationFunc] = activationByName(config.outputActivation);
+
+    MLP mlp(config.learningRate, config.softmax);
+    for (std::size_t l = 0; l + 1 < config.layersNodes.size(); ++l) {
+        mlp.addLayer(config.layersNodes[l], activationFunc, derivActivationFunc);
+    }
+    mlp.addLayer(config.layersNodes.back(), outputActivationFunc, outputDerivActivationFunc);
+    mlp.initializeWeights(config.seed);
+    return mlp;
+}
+
+} // namespace
+
+SweepTrainer::SweepTrainer(const std::vector<std::vector<double>> &trainingInputs,
+                           const std::vector<std::vector<double>> &trainingTargets,
+                           const std::vector<std::vector<double>> &validationInputs,
+                           const std::vector<std::vector<double>> &validationTargets)
+    : trainingInputs(trainingInputs), trainingTargets(trainingTargets), validationInputs(validationInputs),
+      validationTargets(validationTargets) {
+    if (trainingInputs.size() != trainingTargets.size() || validationInputs.size() != validationTargets.size()) {
+        throw std::invalid_argument("Input data and target data must have the same number of entries.");
+    }
+}
+
+// Train every configuration and return their validation results in the same order. With interleaveSameShape, models
+// with the same topology, activations and seed are trained together by one worker, stepping all of them on each
+// sample before moving to the next one so every sample is read once per epoch for the whole group.
+std::vector<SweepResult> SweepTrainer::run(const std::vector<SweepConfig> &configs, std::size_t numThreads,
+                                           bool interleaveSameShape) {
+    if (configs.empty()) {
+        throw std::invalid_argument("At least one configuration is needed for a sweep.");
+    }
+
+    // Models are built up front, with their weights drawn from the seed of their configuration
+    models.clear();
+    models.reserve(configs.size());
+    for (const auto &config : configs) {
+        models.push_back(buildModel(config));
+    }
+
+    std::vector<std::vector<std::size_t>> groups;
+    if (interleaveSameShape) {
+        std::map<std::tuple<std::vector<std::size_t>, std::string, std::string, bool, unsigned>, std::size_t> groupOf;
+        for (std::size_t i = 0; i < configs.size(); ++i) {
+            const auto &config = configs[i];
+            auto key = std::tuple(config.layersNodes, config.activation, config.outputActivation, config.softmax,
+                                  config.seed);
+            auto [it, inserted] = groupOf.try_emplace(key, groups.size());
+            if (inserted) {
+                groups.emplace_back();
+            }
+            groups[it->second].push_back(i);
+        }
+    } else {
+        for (std::size_t i = 0; i < configs.size(); ++i) {
+            groups.push_back({i});
+        }
+    }
+
+    numThreads = std::clamp<std::size_t>(numThreads, 1, groups.size());
+    std::vector<StealingQueue> queues(numThreads);
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+        queues[g % numThreads].push(g);
+    }
+
+    std::vector<SweepResult> results(configs.size());
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    auto worker = [&](std::size_t self) {
+        while (true) {
+            std::optional<std::size_t> task = queues[self].pop();
+            for (std::size_t offset = 1; !task && offset < numThreads; ++offset) {
+                task = queues[(self + offset) % numThreads].steal();
+            }
+            // No task is ever added once the sweep started, so empty queues everywhere means the work is done
+            if (!task) {
+                return;
+            }
+            try {
+                trainGroup(groups[*task], configs);
+                for (std::size_t index : groups[*task]) {
+                    results[index] = validate(index);
+                }
+            } catch (...) {
+                std::scoped_lock lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < numThreads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    bestIndex = std::ranges::min_element(results, {}, &SweepResult::validationLoss)->configIndex;
+    return results;
+}
+
+const MLP &SweepTrainer::getModel(std::size_t configIndex) const {
+    if (configIndex >= models.size()) {
+        throw std::out_of_range(std::format("No model for configuration {}, {} models have been trained", configIndex,
+                                            models.size()));
+    }
+    return models[configIndex];
+}
+
+// Model with the lowest validation loss of the last run
+const MLP &SweepTrainer::getBestModel() const { return getModel(bestIndex); }
+
+// The samples are visited in a different order every epoch, drawn from the seed of the group, without moving the
+// shared data. The orders are the same MLP::train uses with shuffling enabled.
+void SweepTrainer::trainGroup(const std::vector<std::size_t> &group, const std::vector<SweepConfig> &configs) {
+    std::vector<std::size_t> order(trainingInputs.size());
+
+    std::size_t maxEpochs = 0;
+    for (std::size_t index : group) {
+        maxEpochs = std::max(maxEpochs, configs[index].epochs);
+    }
+    for (std::size_t epoch = 0; epoch < maxEpochs; ++epoch) {
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        CounterRng(configs[group.front()].seed, kShuffleStream + epoch).shuffle(order);
+        for (std::size_t sample : order) {
+            for (std::size_t index : group) {
+                if (epoch < configs[index].epochs) {
+                    models[index].feedForward(trainingInputs[sample]);
+                    models[index].backPropagate(trainingTargets[sample]);
+                }
+            }
+        }
+    }
+}
+
+SweepResult SweepTrainer::validate(std::size_t configIndex) {
+    SweepResult result;
+    result.configIndex = configIndex;
+    if (validationInputs.empty()) {
+        return result;
+    }
+
+    double squaredError = 0.0;
+    std::size_t numOutputs = 0;
+    std::size_t correct = 0;
+    for (std::size_t i = 0; i < validationInputs.size(); ++i) {
+        std::vector<double> output = models[configIndex].predict(validationInputs[i]);
+        const std::vector<double> &target = validationTargets[i];
+        if (target.size() != output.size()) {
+            throw std::invalid_argument(std::format("Validation target {} has {} values, the network has {} outputs",
+                                                    i, target.size(), output.size()));
+        }
+        for (std::size_t o = 0; o < output.size(); ++o) {
+            squaredError += (output[o] - target[o]) * (output[o] - target[o]);
+        }
+        numOutputs += output.size();
+        if (std::distance(output.begin(), std::ranges::max_element(output)) ==
+            std::distance(target.begin(), std::ranges::max_element(target))) {
+            ++correct;
+        }
+    }
+    result.validationLoss = squaredError / static_cast<double>(numOutputs);
+    result.validationAccuracy = static_cast<double>(correct) / static_cast<double>(validationInputs.size());
+    return result;
+}
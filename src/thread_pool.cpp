@@ -0,0 +1,109 @@
+#include "thread_pool.h"
+#include "spin_wait.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// numThreads counts the calling thread, which always takes part in the work, so only numThreads - 1 are spawned
+ThreadPool::ThreadPool(std::size_t numThreads) {
+    std::size_t numWorkers = numThreads > 1 ? numThreads - 1 : 0;
+    workers.reserve(numWorkers);
+    for (std::size_t i = 0; i < numWorkers; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    stopping.store(true, std::memory_order_release);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+std::size_t ThreadPool::size() const noexcept { return workers.size() + 1; }
+
+// Split [0, count) into one contiguous chunk per thread and call task(begin, end) on each of them. Returns once every
+// chunk is done, so consecutive calls are separated by a barrier. Concurrent callers are serialized.
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t, std::size_t)> &task) {
+    if (count == 0) {
+        return;
+    }
+    if (workers.empty() || count == 1) {
+        task(0, count);
+        return;
+    }
+
+    std::scoped_lock lock(submitMutex);
+    job = &task;
+    jobCount = count;
+    error = nullptr;
+    pending.store(static_cast<std::uint32_t>(workers.size()), std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+
+    runPart(0);
+
+    // Wait for the workers, spinning first since the chunks are usually balanced
+    std::uint32_t remaining = 0;
+    spinUntil([&] {
+        remaining = pending.load(std::memory_order_acquire);
+        return remaining == 0;
+    });
+    while (remaining != 0) {
+        pending.wait(remaining, std::memory_order_acquire);
+        remaining = pending.load(std::memory_order_acquire);
+    }
+    job = nullptr;
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(std::size_t part) {
+    std::uint32_t seen = 0;
+    while (true) {
+        std::uint32_t current = seen;
+        spinUntil([&] {
+            current = generation.load(std::memory_order_acquire);
+            return current != seen;
+        });
+        if (current == seen) {
+            generation.wait(seen, std::memory_order_acquire);
+            continue;
+        }
+        seen = current;
+
+        if (stopping.load(std::memory_order_acquire)) {
+            return;
+        }
+        runPart(part);
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            pending.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runPart(std::size_t part) noexcept {
+    std::size_t chunk = (jobCount + size() - 1) / size();
+    std::size_t begin = std::min(jobCount, part * chunk);
+    std::size_t end = std::min(jobCount, begin + chunk);
+    if (begin == end) {
+        return;
+    }
+    try {
+        (*job)(begin, end);
+    } catch (...) {
+        std::scoped_lock lock(errorMutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#include "transport.h"
+#include <cstddef>
+#include <vector>
+
+// Replace values with their sum over all the ranks. The vector is split in one chunk per rank, each chunk is summed
+// while travelling once around the ring and the sums travel around once more, so every rank sends and receives about
+// twice the size of the vector whatever the number of ranks. All the ranks must pass vectors of the same size.
+void ringAllReduce(Transport &transport, std::vector<double> &values) {
+    std::size_t size = transport.size();
+    if (size <= 1) {
+        return;
+    }
+    std::size_t rank = transport.rank();
+    auto chunkBegin = [&](std::size_t chunk) { return values.size() * chunk / size; };
+    auto chunkSize = [&](std::size_t chunk) { return chunkBegin(chunk + 1) - chunkBegin(chunk); };
+
+    std::vector<double> received(values.size() / size + 1);
+    // Reduce-scatter, after which this rank holds the total of chunk rank + 1
+    for (std::size_t step = 0; step + 1 < size; ++step) {
+        std::size_t sendChunk = (rank + size - step) % size;
+        std::size_t receiveChunk = (rank + size - step - 1) % size;
+        transport.exchange(values.data() + chunkBegin(sendChunk), chunkSize(sendChunk), received.data(),
+                           chunkSize(receiveChunk));
+        double *target = values.data() + chunkBegin(receiveChunk);
+        for (std::size_t i = 0; i < chunkSize(receiveChunk); ++i) {
+            target[i] += received[i];
+        }
+    }
+    // All-gather, the totals are passed along and overwrite the partial sums
+    for (std::size_t step = 0; step + 1 < size; ++step) {
+        std::size_t sendChunk = (rank + size + 1 - step) % size;
+        std::size_t receiveChunk = (rank + size - step) % size;
+        transport.exchange(values.data() + chunkBegin(sendChunk), chunkSize(sendChunk),
+                           values.data() + chunkBegin(receiveChunk), chunkSize(receiveChunk));
+    }
+}
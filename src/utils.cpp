@@ -1,8 +1,13 @@
 #include "utils.h"
+#include "sparse_vector.h"
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <functional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -34,6 +39,44 @@ double fidentity(double x) { return x; }
 
 double fidentityDerivative(double /*x*/) { return 1.0; }
 
+// Name of one of the predefined activation functions above, or an empty string if it is not one of them
+std::string activationName(const std::function<double(double)> &activationFunc) {
+    const auto *target = activationFunc.target<double (*)(double)>();
+    if (target == nullptr) {
+        return "";
+    }
+    if (*target == fsigmoid) {
+        return "sigmoid";
+    }
+    if (*target == ftanh) {
+        return "tanh";
+    }
+    if (*target == frelu) {
+        return "relu";
+    }
+    if (*target == fidentity) {
+        return "identity";
+    }
+    return "";
+}
+
+// Predefined activation function and its derivative by name, the inverse of activationName
+std::pair<double (*)(double), double (*)(double)> activationByName(const std::string &name) {
+    if (name == "sigmoid") {
+        return {fsigmoid, fsigmoidDerivative};
+    }
+    if (name == "tanh") {
+        return {ftanh, ftanhDerivative};
+    }
+    if (name == "relu") {
+        return {frelu, freluDerivative};
+    }
+    if (name == "identity") {
+        return {fidentity, fidentityDerivative};
+    }
+    throw std::invalid_argument("Unknown activation function: " + name);
+}
+
 // Utility function for one-hot encoding
 std::vector<double> oneHotEncode(double value, int categories) {
     std::vector<double> encoded(categories, 0.0);
@@ -41,6 +84,11 @@ std::vector<double> oneHotEncode(double value, int categories) {
     return encoded;
 }
 
+// Same encoding with only the single nonzero entry stored, one-hot columns can be concatenated with append
+SparseVector oneHotEncodeSparse(double value, int categories) {
+    return {static_cast<std::size_t>(categories), {static_cast<std::uint32_t>(value)}, {1.0}};
+}
+
 // Utility function to parse a CSV file into a vector
 std::vector<std::vector<double>> parseCSV(std::ifstream &file, int skipHeaderLines, const std::vector<int> &skipColumns,
                                           const std::unordered_map<std::string, double> &conversionRules) {
@@ -84,4 +132,12 @@ std::vector<std::vector<double>> parseCSV(std::ifstream &file, int skipHeaderLin
     }
 
     return data;
-}
\ No newline at end of file
+}
+// Bytes between the read position and the end of the file, to check sizes read from a file before allocating them
+std::size_t remainingBytes(std::ifstream &in) {
+    std::streampos position = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streampos end = in.tellg();
+    in.seekg(position);
+    return position < 0 || end < position ? 0 : static_cast<std::size_t>(end - position);
+}
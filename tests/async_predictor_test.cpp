@@ -0,0 +1,96 @@
+#include "async_predictor.h"
+#include "mlp.h"
+#include "utils.h"
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <latch>
+#include <stdexcept>
+#include <vector>
+
+// Minimal fire-and-forget coroutine type, serving code would use its own task type
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+void testConcurrentRequests();
+void testInvalidInput();
+
+int main() {
+    try {
+        testConcurrentRequests();
+        testInvalidInput();
+
+        std::cout << "All async predictor tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+DetachedTask predictInto(AsyncPredictor &predictor, std::vector<double> input, std::vector<double> &result,
+                         std::latch &done) {
+    result = co_await predictor.asyncPredict(std::move(input));
+    done.count_down();
+}
+
+void testConcurrentRequests() {
+    MLP mlp({3, 32, 32, 2}, 0.01, ftanh, ftanhDerivative, true);
+    constexpr std::size_t numRequests = 2000;
+
+    std::vector<std::vector<double>> inputs;
+    std::vector<std::vector<double>> expected;
+    for (std::size_t i = 0; i < numRequests; ++i) {
+        double x = static_cast<double>(i) / numRequests;
+        inputs.push_back({x, 1.0 - x, x * x});
+        expected.push_back(mlp.predict(inputs.back()));
+    }
+
+    std::vector<std::vector<double>> results(numRequests);
+    std::latch done(numRequests);
+    {
+        AsyncPredictor predictor(mlp, 2, 16);
+        // Thousands of requests in flight at the same time, served by two executor threads
+        for (std::size_t i = 0; i < numRequests; ++i) {
+            predictInto(predictor, inputs[i], results[i], done);
+        }
+        done.wait();
+    }
+
+    for (std::size_t i = 0; i < numRequests; ++i) {
+        assert(results[i].size() == expected[i].size());
+        for (std::size_t o = 0; o < results[i].size(); ++o) {
+            assert(approxEqual(results[i][o], expected[i][o], 1e-12));
+        }
+    }
+}
+
+DetachedTask predictExpectingError(AsyncPredictor &predictor, std::atomic<bool> &thrown, std::latch &done) {
+    std::vector<double> input{1.0}; // the network expects 3 inputs
+    try {
+        auto result = co_await predictor.asyncPredict(input);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    done.count_down();
+}
+
+void testInvalidInput() {
+    MLP mlp({3, 4, 2}, 0.01, frelu, freluDerivative);
+    AsyncPredictor predictor(mlp);
+    std::atomic<bool> thrown{false};
+    std::latch done(1);
+    predictExpectingError(predictor, thrown, done);
+    done.wait();
+    assert(thrown);
+}
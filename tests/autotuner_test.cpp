@@ -0,0 +1,132 @@
+#include "autotuner.h"
+#include "bfloat16.h"
+#include "mlp.h"
+#include "packed_model.h"
+#include "utils.h"
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void testKernelConfigs();
+void testTuning();
+void testCacheFile();
+
+int main() {
+    try {
+        testKernelConfigs();
+        testTuning();
+        testCacheFile();
+
+        std::cout << "All autotuner tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+std::vector<std::vector<double>> makeBatch(std::size_t batchSize, std::size_t numInputs) {
+    std::vector<std::vector<double>> batch(batchSize, std::vector<double>(numInputs));
+    for (std::size_t b = 0; b < batchSize; ++b) {
+        for (std::size_t i = 0; i < numInputs; ++i) {
+            batch[b][i] = static_cast<double>((b + 3 * i) % 11) / 5.0 - 1.0;
+        }
+    }
+    return batch;
+}
+
+void testKernelConfigs() {
+    // Widths that are not multiples of the row blocks
+    MLP mlp({13, 30, 7, 3}, 0.01, ftanh, ftanhDerivative, true);
+    for (WeightPrecision precision : {WeightPrecision::Double, WeightPrecision::Bfloat16}) {
+        PackedModel packed(mlp, false, false, precision);
+        std::vector<std::vector<double>> batch = makeBatch(37, 13);
+        std::vector<std::vector<double>> expected = packed.predictBatch(batch);
+
+        // Every configuration gives exactly the same results
+        for (std::size_t tile : {0, 1, 4, 16}) {
+            for (std::size_t rowBlock : {1, 2, 4, 8}) {
+                for (std::size_t threads : {1, 3}) {
+                    packed.setKernelConfig({tile, rowBlock, threads});
+                    assert(packed.predictBatch(batch) == expected);
+                    assert(packed.predict(batch[5]) == expected[5]);
+                }
+            }
+        }
+    }
+
+    PackedModel packed(mlp, false, false);
+    bool thrown = false;
+    try {
+        packed.setKernelConfig({0, 3, 1});
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void testTuning() {
+    std::string cachePath = "test_tuning_cache.txt";
+    std::remove(cachePath.c_str());
+    MLP mlp({64, 128, 128, 10}, 0.01, frelu, freluDerivative);
+    PackedModel packed(mlp, false, false);
+
+    Autotuner tuner(cachePath, std::chrono::milliseconds{1});
+    assert(!tuner.lookup(packed, 32).has_value());
+    KernelConfig config = tuner.tune(packed, 32);
+    assert(packed.kernelConfig() == config);
+    assert(tuner.lookup(packed, 32) == config);
+    // Other batch sizes and precisions are tuned separately
+    assert(!tuner.lookup(packed, 64).has_value());
+    assert(!tuner.lookup(PackedModel(mlp, false, false, WeightPrecision::Bfloat16), 32).has_value());
+
+    // A later run reads the decision back and applies it without measuring
+    PackedModel fresh(mlp, false, false);
+    Autotuner later(cachePath);
+    assert(later.lookup(fresh, 32) == config);
+    assert(later.tune(fresh, 32) == config);
+    assert(fresh.kernelConfig() == config);
+    assert(fresh.predictBatch(makeBatch(32, 64)) == PackedModel(mlp, false, false).predictBatch(makeBatch(32, 64)));
+
+    // Several concurrent callers keep every batch on one thread and are cached apart from a single caller
+    KernelConfig shared = later.tune(fresh, 32, 4);
+    assert(shared.numThreads == 1);
+    assert(fresh.kernelConfig() == shared);
+    assert(later.lookup(fresh, 32, 4) == shared);
+    assert(later.lookup(fresh, 32) == config);
+    assert(Autotuner(cachePath).lookup(fresh, 32, 2) == shared);
+
+    std::remove(cachePath.c_str());
+}
+
+void testCacheFile() {
+    std::string cachePath = "test_tuning_cache.txt";
+    MLP mlp({4, 10, 10, 3}, 0.01, frelu, freluDerivative);
+    PackedModel packed(mlp, false, false);
+    {
+        std::ofstream out(cachePath);
+        out << "garbage line\n"
+            << Autotuner::cpuModel() << "\t4-10-10-3\t8\tdouble\t2 4 1\n"
+            << Autotuner::cpuModel() << "\t4-10-10-3\t16\tdouble\tnot a config\n"
+            << Autotuner::cpuModel() << "\t4-10-10-3\t32\tdouble\t0 3 1\n"
+            << Autotuner::cpuModel() << "\t4-10-10-3\t64\tdouble\t0 4 0\n"
+            << Autotuner::cpuModel() << "\t4-10-10-3\t128\tdouble\t0 4 1000000\n";
+    }
+
+    // Malformed lines and configurations this machine cannot run are skipped
+    Autotuner tuner(cachePath);
+    assert((tuner.lookup(packed, 8) == KernelConfig{2, 4, 1}));
+    for (std::size_t batchSize : {16, 32, 64, 128}) {
+        assert(!tuner.lookup(packed, batchSize).has_value());
+    }
+
+    std::remove(cachePath.c_str());
+}
@@ -0,0 +1,77 @@
+#include "bfloat16.h"
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+void testConversion();
+void testRounding();
+void testDotProduct();
+
+int main() {
+    try {
+        testConversion();
+        testRounding();
+        testDotProduct();
+
+        std::cout << "All bfloat16 tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void testConversion() {
+    // Values with at most 8 significant bits are exact
+    for (double value : {0.0, 1.0, -2.0, 0.5, 3.0, -0.375, 1024.0}) {
+        assert(fromBfloat16(toBfloat16(value)) == static_cast<float>(value));
+    }
+    assert(toBfloat16(1.0) == 0x3F80);
+    assert(toBfloat16(-2.0) == 0xC000);
+    assert(std::isinf(fromBfloat16(toBfloat16(std::numeric_limits<double>::infinity()))));
+    assert(std::isnan(fromBfloat16(toBfloat16(std::numeric_limits<double>::quiet_NaN()))));
+
+    // Rounding error is at most half a unit in the last place, 2^-8 of the value
+    for (double value = -10.0; value < 10.0; value += 0.0123) {
+        double converted = fromBfloat16(toBfloat16(value));
+        assert(std::abs(converted - value) <= std::abs(value) * 0x1.0p-8);
+    }
+}
+
+void testRounding() {
+    // 1 + 2^-8 lies halfway between 1 and the next bfloat16, ties go to the even mantissa
+    assert(toBfloat16(1.0 + 0x1.0p-8) == 0x3F80);
+    assert(toBfloat16(1.0 + 0x1.0p-7 + 0x1.0p-8) == 0x3F82);
+    assert(toBfloat16(1.0 + 0x1.0p-8 + 0x1.0p-12) == 0x3F81);
+
+    // Bits below the precision of a float still decide which way a near tie goes
+    assert(toBfloat16(1.0 + 0x1.0p-8 + 0x1.0p-30) == 0x3F81);
+    assert(toBfloat16(1.0 + 0x1.0p-7 + 0x1.0p-8 - 0x1.0p-30) == 0x3F81);
+    assert(toBfloat16(-(1.0 + 0x1.0p-8 + 0x1.0p-30)) == 0xBF81);
+
+    // Doubles beyond the range of a float overflow to infinity and underflow to zero, keeping their sign
+    assert(toBfloat16(1e300) == 0x7F80);
+    assert(toBfloat16(-1e300) == 0xFF80);
+    assert(toBfloat16(1e-300) == 0x0000);
+    assert(toBfloat16(-1e-300) == 0x8000);
+}
+
+void testDotProduct() {
+    // Odd lengths exercise the tail after the vectorized part
+    for (std::size_t count : {0, 1, 15, 16, 17, 100}) {
+        std::vector<std::uint16_t> weights(count);
+        std::vector<float> inputs(count);
+        double expected = 0.0;
+        for (std::size_t i = 0; i < count; ++i) {
+            weights[i] = toBfloat16(static_cast<double>(i % 5) * 0.25 - 0.5);
+            inputs[i] = static_cast<float>(i % 3) - 1.0F;
+            expected += static_cast<double>(fromBfloat16(weights[i])) * inputs[i];
+        }
+        assert(std::abs(dotBfloat16(weights.data(), inputs.data(), count) - expected) < 1e-4);
+    }
+}
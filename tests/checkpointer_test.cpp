@@ -0,0 +1,167 @@
+#include "checkpointer.h"
+#include "mlp.h"
+#include "utils.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void testWriteAndLoad();
+void testNewestSnapshotWins();
+void testMissingCheckpoint();
+void testResumeTraining();
+void testCorruptedCheckpoint();
+
+int main() {
+    try {
+        testWriteAndLoad();
+        testNewestSnapshotWins();
+        testMissingCheckpoint();
+        testResumeTraining();
+        testCorruptedCheckpoint();
+
+        std::cout << "All checkpointer tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void testWriteAndLoad() {
+    std::string filename = "test_checkpoint.bin";
+    {
+        Checkpointer checkpointer(filename);
+        checkpointer.submit(3, {1.0, 2.0, 3.0});
+        checkpointer.flush();
+    }
+
+    std::size_t epoch = 0;
+    std::vector<double> parameters;
+    bool found = Checkpointer::load(filename, 3, epoch, parameters);
+    assert(found);
+    assert(epoch == 3);
+    assert((parameters == std::vector<double>{1.0, 2.0, 3.0}));
+
+    // The temporary file used for the atomic replacement does not stay around
+    assert(!std::filesystem::exists(filename + ".tmp"));
+    std::remove(filename.c_str());
+}
+
+void testNewestSnapshotWins() {
+    std::string filename = "test_checkpoint_newest.bin";
+    {
+        Checkpointer checkpointer(filename);
+        for (std::size_t epoch = 1; epoch <= 100; ++epoch) {
+            checkpointer.submit(epoch, std::vector<double>(1000, static_cast<double>(epoch)));
+        }
+        // The destructor writes whatever is still pending
+    }
+
+    std::size_t epoch = 0;
+    std::vector<double> parameters;
+    bool found = Checkpointer::load(filename, 1000, epoch, parameters);
+    assert(found);
+    assert(epoch == 100);
+    assert(parameters.size() == 1000 && parameters.front() == 100.0);
+    std::remove(filename.c_str());
+}
+
+void testMissingCheckpoint() {
+    std::size_t epoch = 7;
+    std::vector<double> parameters;
+    bool found = Checkpointer::load("test_checkpoint_missing.bin", 1, epoch, parameters);
+    assert(!found);
+    assert(epoch == 7);
+
+    // Write errors surface on the training thread
+    {
+        Checkpointer checkpointer("nonexistent_dir/checkpoint.bin");
+        checkpointer.submit(1, {1.0});
+        bool thrown = false;
+        try {
+            checkpointer.flush();
+        } catch (const std::exception &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+
+void testResumeTraining() {
+    std::string filename = "test_checkpoint_training.bin";
+    std::vector<std::vector<double>> inputs = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+    std::vector<std::vector<double>> targets = {{0.0}, {1.0}, {1.0}, {0.0}};
+
+    MLP initial({2, 4, 1}, 0.1, ftanh, ftanhDerivative);
+    MLP uninterrupted = initial;
+    uninterrupted.train(inputs, targets, 20);
+
+    // Stop halfway, then resume from the checkpoint with a network that starts from different weights
+    MLP interrupted = initial;
+    interrupted.train(inputs, targets, 10, filename, 5);
+    MLP resumed({2, 4, 1}, 0.1, ftanh, ftanhDerivative);
+    resumed.train(inputs, targets, 20, filename, 5);
+
+    assert(resumed.getParameters() == uninterrupted.getParameters());
+    std::size_t epoch = 0;
+    std::vector<double> parameters;
+    Checkpointer::load(filename, uninterrupted.getNumParameters(), epoch, parameters);
+    assert(epoch == 20);
+    assert(parameters == uninterrupted.getParameters());
+    std::remove(filename.c_str());
+}
+
+bool loadFails(const std::string &filename, std::size_t expectedParameters) {
+    std::size_t epoch = 0;
+    std::vector<double> parameters;
+    try {
+        Checkpointer::load(filename, expectedParameters, epoch, parameters);
+    } catch (const std::runtime_error &) {
+        return parameters.empty();
+    }
+    return false;
+}
+
+void testCorruptedCheckpoint() {
+    std::string filename = "test_checkpoint_corrupted.bin";
+    {
+        Checkpointer checkpointer(filename);
+        checkpointer.submit(2, {1.0, 2.0, 3.0});
+    }
+
+    // Checkpoints of another network are rejected before reading their parameters
+    assert(loadFails(filename, 4));
+
+    // A count the file cannot hold fails before allocating, even when it is the expected one
+    const std::uint64_t hugeCount = std::uint64_t{1} << 60;
+    {
+        std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(sizeof(std::uint64_t) + sizeof(std::uint32_t) + sizeof(std::uint64_t));
+        file.write(reinterpret_cast<const char *>(&hugeCount), sizeof(hugeCount));
+    }
+    assert(loadFails(filename, hugeCount));
+    std::remove(filename.c_str());
+
+    // Training with a checkpoint of a network of another shape throws instead of resuming from it
+    {
+        Checkpointer checkpointer(filename);
+        checkpointer.submit(2, {1.0, 2.0, 3.0});
+    }
+    MLP mlp({2, 4, 1}, 0.1, ftanh, ftanhDerivative);
+    bool thrown = false;
+    try {
+        mlp.train({{0, 1}}, {{1.0}}, 5, filename, 1);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::remove(filename.c_str());
+}
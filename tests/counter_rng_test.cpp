@@ -0,0 +1,145 @@
+#include "counter_rng.h"
+#include "mlp.h"
+#include "utils.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+void testDeterminism();
+void testUniformRange();
+void testShuffle();
+void testParallelInitialization();
+void testShuffledTraining();
+
+int main() {
+    try {
+        testDeterminism();
+        testUniformRange();
+        testShuffle();
+        testParallelInitialization();
+        testShuffledTraining();
+
+        std::cout << "All CounterRng tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void testDeterminism() {
+    CounterRng rng(42, 7);
+    CounterRng same(42, 7);
+    CounterRng otherStream(42, 8);
+    CounterRng otherSeed(43, 7);
+
+    // Draws can be taken in any order and still match
+    for (std::size_t i = 100; i-- > 0;) {
+        assert(rng(i) == same(i));
+    }
+    std::size_t collisions = 0;
+    for (std::size_t i = 0; i < 100; ++i) {
+        collisions += static_cast<std::size_t>(rng(i) == otherStream(i) || rng(i) == otherSeed(i));
+        collisions += static_cast<std::size_t>(rng(i) == rng(i + 1));
+    }
+    assert(collisions == 0);
+}
+
+void testUniformRange() {
+    CounterRng rng(1, 0);
+    double sum = 0.0;
+    const std::size_t numDraws = 100000;
+    for (std::size_t i = 0; i < numDraws; ++i) {
+        double value = rng.uniform(i);
+        assert(value >= 0.0 && value < 1.0);
+        sum += value;
+    }
+    assert(std::abs(sum / numDraws - 0.5) < 0.01);
+}
+
+void testShuffle() {
+    std::vector<std::size_t> identity(1000);
+    std::iota(identity.begin(), identity.end(), std::size_t{0});
+
+    std::vector<std::size_t> first = identity;
+    std::vector<std::size_t> again = identity;
+    std::vector<std::size_t> nextEpoch = identity;
+    CounterRng(5, kShuffleStream).shuffle(first);
+    CounterRng(5, kShuffleStream).shuffle(again);
+    CounterRng(5, kShuffleStream + 1).shuffle(nextEpoch);
+
+    assert(first == again);
+    assert(first != identity);
+    assert(first != nextEpoch);
+    std::vector<std::size_t> sorted = first;
+    std::ranges::sort(sorted);
+    assert(sorted == identity);
+}
+
+void testParallelInitialization() {
+    MLP serial({32, 512, 256, 10}, 0.01, frelu, freluDerivative);
+    serial.initializeWeights(1234);
+    std::vector<double> expected = serial.getParameters();
+
+    // The weights of each neuron come from its own stream, so splitting the layers differently changes nothing
+    for (std::size_t numThreads : {2, 3, 8}) {
+        MLP parallel({32, 512, 256, 10}, 0.01, frelu, freluDerivative);
+        parallel.setParallelism(numThreads, 0);
+        parallel.initializeWeights(1234);
+        assert(parallel.getParameters() == expected);
+        assert(parallel.getSeed() == 1234);
+    }
+
+    serial.initializeWeights(1235);
+    assert(serial.getParameters() != expected);
+
+    // Networks given threads at construction draw their first weights in parallel, with the same result
+    MLP constantSerial({64, 1024, 512, 10}, 0.01, frelu, freluDerivative, false, true);
+    for (std::size_t numThreads : {2, 3, 8}) {
+        MLP constantParallel({64, 1024, 512, 10}, 0.01, frelu, freluDerivative, false, true, numThreads);
+        assert(constantParallel.getParameters() == constantSerial.getParameters());
+    }
+    MLP seeded({64, 1024, 512, 10}, 0.01, frelu, freluDerivative, false, false, 4);
+    std::vector<double> drawn = seeded.getParameters();
+    seeded.setParallelism(1);
+    seeded.initializeWeights(seeded.getSeed());
+    assert(seeded.getParameters() == drawn);
+
+    // Constant initialization is the same for every network of the same shape
+    MLP constant({32, 512, 256, 10}, 0.01, frelu, freluDerivative, false, true);
+    MLP constantAgain({32, 512, 256, 10}, 0.01, frelu, freluDerivative, false, true);
+    assert(constant.getParameters() == constantAgain.getParameters());
+
+    // Layers added with constant initialization use the same seed, which the network then reports
+    MLP added(0.01);
+    added.addLayer(32, frelu, freluDerivative, false, true);
+    added.addLayer(512, frelu, freluDerivative, false, true);
+    added.addLayer(256, frelu, freluDerivative, false, true);
+    added.addLayer(10, frelu, freluDerivative, false, true);
+    assert(added.getSeed() == constant.getSeed());
+    assert(added.getParameters() == constant.getParameters());
+    added.initializeWeights(added.getSeed());
+    assert(added.getParameters() == constant.getParameters());
+}
+
+void testShuffledTraining() {
+    std::vector<std::vector<double>> inputs = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+    std::vector<std::vector<double>> targets = {{0.0}, {1.0}, {1.0}, {0.0}};
+
+    MLP ordered({2, 4, 1}, 0.1, ftanh, ftanhDerivative, false, true);
+    MLP shuffled({2, 4, 1}, 0.1, ftanh, ftanhDerivative, false, true);
+    MLP shuffledAgain({2, 4, 1}, 0.1, ftanh, ftanhDerivative, false, true);
+    shuffled.setShuffle(true);
+    shuffledAgain.setShuffle(true);
+
+    ordered.train(inputs, targets, 20);
+    shuffled.train(inputs, targets, 20);
+    shuffledAgain.train(inputs, targets, 20);
+    assert(shuffled.getParameters() == shuffledAgain.getParameters());
+    assert(shuffled.getParameters() != ordered.getParameters());
+}
@@ -0,0 +1,146 @@
+#include "mlp.h"
+#include "shared_memory_transport.h"
+#include "transport.h"
+#include "utils.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+void testAllReduce();
+void testDataParallelTraining();
+void testMismatchedNetworks();
+
+int main() {
+    try {
+        testAllReduce();
+        testDataParallelTraining();
+        testMismatchedNetworks();
+
+        std::cout << "All distributed tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+// Run worker in size forked processes connected by a fresh segment, asserts fail in the children so they report
+// through their exit status
+bool runWorkers(std::size_t size, std::size_t slotCapacity,
+                const std::function<bool(SharedMemoryTransport &)> &worker) {
+    static std::size_t job = 0;
+    std::string name = "/mlp_distributed_test_" + std::to_string(getpid()) + "_" + std::to_string(job++);
+    std::vector<pid_t> children;
+    for (std::size_t rank = 0; rank < size; ++rank) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bool passed = false;
+            try {
+                SharedMemoryTransport transport(name, rank, size, std::chrono::milliseconds{10000}, slotCapacity);
+                passed = worker(transport);
+            } catch (const std::exception &ex) {
+                std::cerr << "Worker " << rank << " failed: " << ex.what() << '\n';
+            }
+            _exit(passed ? 0 : 1);
+        }
+        assert(pid > 0);
+        children.push_back(pid);
+    }
+
+    bool passed = true;
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        passed = passed && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return passed;
+}
+
+void testAllReduce() {
+    for (std::size_t size : {1, 2, 3, 5}) {
+        // Lengths not divisible by the number of ranks, shorter than it and longer than a slot
+        for (std::size_t length : {1, 7, 100}) {
+            bool passed = runWorkers(size, 16, [&](SharedMemoryTransport &transport) {
+                std::vector<double> values(length);
+                for (std::size_t i = 0; i < length; ++i) {
+                    values[i] = static_cast<double>((transport.rank() + 1) * (i + 1));
+                }
+                ringAllReduce(transport, values);
+                auto rankSum = static_cast<double>(size * (size + 1) / 2);
+                for (std::size_t i = 0; i < length; ++i) {
+                    if (values[i] != rankSum * static_cast<double>(i + 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+            assert(passed);
+        }
+    }
+}
+
+void testDataParallelTraining() {
+    // Every worker fits y = sin(x) on its own interleaved shard
+    const std::size_t size = 3;
+    bool passed = runWorkers(size, SharedMemoryTransport::kDefaultSlotCapacity, [&](SharedMemoryTransport &transport) {
+        std::vector<std::vector<double>> inputs;
+        std::vector<std::vector<double>> targets;
+        for (std::size_t i = transport.rank(); i < 300; i += size) {
+            double x = -3.0 + 6.0 * static_cast<double>(i) / 300.0;
+            inputs.push_back({x});
+            targets.push_back({std::sin(x)});
+        }
+
+        auto meanError = [&](MLP &mlp) {
+            double error = 0.0;
+            for (std::size_t i = 0; i < inputs.size(); ++i) {
+                error += std::abs(mlp.predict(inputs[i])[0] - targets[i][0]);
+            }
+            return error / static_cast<double>(inputs.size());
+        };
+
+        // Each rank starts from different weights, training adopts those of rank 0 even without any epoch
+        MLP mlp({1, 16, 1}, 0.01, ftanh, ftanhDerivative);
+        mlp.train(inputs, targets, 0, transport);
+        double initialError = meanError(mlp);
+        mlp.train(inputs, targets, 200, transport, 4);
+
+        std::vector<double> parameters = mlp.getParameters();
+        std::vector<double> reference = parameters;
+        if (transport.rank() != 0) {
+            std::fill(reference.begin(), reference.end(), 0.0);
+        }
+        ringAllReduce(transport, reference);
+        if (parameters != reference) {
+            return false;
+        }
+        return meanError(mlp) < initialError / 2.0;
+    });
+    assert(passed);
+}
+
+void testMismatchedNetworks() {
+    // A worker with another architecture makes every rank throw instead of waiting for the timeout
+    bool passed = runWorkers(3, SharedMemoryTransport::kDefaultSlotCapacity, [](SharedMemoryTransport &transport) {
+        std::vector<std::vector<double>> inputs = {{0.5}};
+        std::vector<std::vector<double>> targets = {{0.25}};
+        MLP mlp({1, transport.rank() == 2 ? 8U : 16U, 1}, 0.01, ftanh, ftanhDerivative);
+        try {
+            mlp.train(inputs, targets, 1, transport);
+        } catch (const std::invalid_argument &) {
+            return true;
+        }
+        return false;
+    });
+    assert(passed);
+}
@@ -0,0 +1,347 @@
+#include "embedding_layer.h"
+#include "mlp.h"
+#include "packed_model.h"
+#include "utils.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void testEmbeddingLayer();
+void testForward();
+void testGradient();
+void testTraining();
+void testSaveAndParameters();
+void testCorruptedFiles();
+void testVersion2File();
+
+int main() {
+    try {
+        testEmbeddingLayer();
+        testForward();
+        testGradient();
+        testTraining();
+        testSaveAndParameters();
+        testCorruptedFiles();
+        testVersion2File();
+
+        std::cout << "All embedding tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void testEmbeddingLayer() {
+    EmbeddingLayer embeddings({5, 3}, 4, 7);
+    assert(embeddings.numColumns() == 2 && embeddings.outputSize() == 8);
+    assert(embeddings.getTable().size() == (5 + 3) * 4);
+    // The same seed gives the same table
+    assert(EmbeddingLayer({5, 3}, 4, 7).getTable() == embeddings.getTable());
+
+    std::vector<double> gathered(8);
+    embeddings.gather({4, 1}, gathered.data());
+    assert(std::vector<double>(gathered.begin(), gathered.begin() + 4) == embeddings.getRow(0, 4));
+    assert(std::vector<double>(gathered.begin() + 4, gathered.end()) == embeddings.getRow(1, 1));
+
+    // Only the gathered rows move
+    std::vector<double> before = embeddings.getTable();
+    std::vector<double> gradients(8, 1.0);
+    embeddings.update({4, 1}, gradients.data(), 0.5);
+    std::size_t changed = 0;
+    for (std::size_t i = 0; i < before.size(); ++i) {
+        changed += static_cast<std::size_t>(embeddings.getTable()[i] != before[i]);
+    }
+    assert(changed == 8);
+    assert(approxEqual(embeddings.getRow(0, 4)[0], before[4 * 4] - 0.5));
+
+    bool thrown = false;
+    try {
+        embeddings.validate({5, 0});
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void testForward() {
+    // Two categorical columns embedded in 3 dimensions, followed by 2 numeric features
+    MLP mlp({8, 10, 2}, 0.01, ftanh, ftanhDerivative, true);
+    mlp.setEmbeddings({6, 4}, 3);
+    CategoricalSample sample{{5, 2}, {0.5, -1.0}};
+
+    std::vector<double> input = mlp.getEmbeddings().getRow(0, 5);
+    std::vector<double> second = mlp.getEmbeddings().getRow(1, 2);
+    input.insert(input.end(), second.begin(), second.end());
+    input.insert(input.end(), sample.features.begin(), sample.features.end());
+    std::vector<double> output = mlp.predict(sample);
+    assert(output == mlp.predict(input));
+
+    bool thrown = false;
+    try {
+        mlp.predict(CategoricalSample{{5, 2}, {0.5}});
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    thrown = false;
+    try {
+        PackedModel packed(mlp);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // A preprocessor would only apply to the dense overloads, so categorical samples reject it
+    mlp.fitPreprocessor({input, std::vector<double>(8, 1.0)},
+                        std::vector<FeatureTransform>(8, FeatureTransform::MinMax));
+    for (bool training : {false, true}) {
+        thrown = false;
+        try {
+            if (training) {
+                mlp.train(std::vector<CategoricalSample>{sample}, {{1.0, 0.0}}, 1);
+            } else {
+                static_cast<void>(mlp.predict(sample));
+            }
+        } catch (const std::logic_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+
+// Squared error of a network with identity outputs and ReLU hidden layers, whose gradient is exactly what
+// backPropagate follows
+double loss(MLP &mlp, const CategoricalSample &sample, const std::vector<double> &target) {
+    std::vector<double> output = mlp.predict(sample);
+    double sum = 0.0;
+    for (std::size_t i = 0; i < output.size(); ++i) {
+        sum += 0.5 * (output[i] - target[i]) * (output[i] - target[i]);
+    }
+    return sum;
+}
+
+void testGradient() {
+    MLP mlp(0.01);
+    mlp.addLayer(5, fidentity, fidentityDerivative);
+    mlp.addLayer(6, frelu, freluDerivative, false, true);
+    mlp.addLayer(2, fidentity, fidentityDerivative, false, true);
+    mlp.setEmbeddings({3, 4}, 2);
+    CategoricalSample sample{{1, 3}, {0.25}};
+    std::vector<double> target{0.3, -0.2};
+
+    // Finite differences of the loss with respect to the entries of the gathered rows
+    std::vector<double> parameters = mlp.getParameters();
+    std::size_t tableStart = parameters.size() - mlp.getEmbeddings().getTable().size();
+    std::vector<std::size_t> entries{tableStart + 1 * 2, tableStart + 1 * 2 + 1, tableStart + (3 + 3) * 2,
+                                     tableStart + (3 + 3) * 2 + 1};
+    std::vector<double> numeric;
+    for (std::size_t entry : entries) {
+        std::vector<double> shifted = parameters;
+        shifted[entry] += 1e-6;
+        mlp.setParameters(shifted);
+        double up = loss(mlp, sample, target);
+        shifted[entry] -= 2e-6;
+        mlp.setParameters(shifted);
+        double down = loss(mlp, sample, target);
+        numeric.push_back((up - down) / 2e-6);
+    }
+    mlp.setParameters(parameters);
+
+    mlp.train(std::vector<CategoricalSample>{sample}, {target}, 1);
+    std::vector<double> updated = mlp.getParameters();
+    for (std::size_t k = 0; k < entries.size(); ++k) {
+        assert(approxEqual(updated[entries[k]], parameters[entries[k]] - 0.01 * numeric[k], 1e-8));
+    }
+    // Rows of the other categories are untouched
+    for (std::size_t i = tableStart; i < updated.size(); ++i) {
+        bool gathered = (i - tableStart) / 2 == 1 || (i - tableStart) / 2 == 6;
+        assert(gathered || updated[i] == parameters[i]);
+    }
+}
+
+void testTraining() {
+    // The target only depends on the parity of the category of the first column
+    std::vector<CategoricalSample> samples;
+    std::vector<std::vector<double>> targets;
+    for (std::uint32_t i = 0; i < 200; ++i) {
+        samples.push_back({{i % 20, (i * 7) % 13}, {static_cast<double>(i % 3)}});
+        targets.push_back({i % 20 % 2 == 0 ? 1.0 : 0.0});
+    }
+    MLP mlp({9, 8, 1}, 0.05, ftanh, ftanhDerivative, false, true);
+    mlp.setEmbeddings({20, 13}, 4);
+    mlp.setShuffle(true);
+    mlp.train(samples, targets, 50);
+
+    std::size_t correct = 0;
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        correct += static_cast<std::size_t>((mlp.predict(samples[i])[0] > 0.5) == (targets[i][0] > 0.5));
+    }
+    assert(correct >= 190);
+}
+
+std::vector<char> readBytes(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void testSaveAndParameters() {
+    std::string filename = "test_embedding_model.bin";
+    MLP mlp({7, 6, 2}, 0.01, frelu, freluDerivative, true);
+    mlp.setEmbeddings({10, 5, 3}, 2);
+    assert(mlp.getNumParameters() == 7 * 6 + 6 * 2 + (10 + 5 + 3) * 2);
+    CategoricalSample sample{{9, 0, 2}, {1.5}};
+    mlp.train(std::vector<CategoricalSample>{sample}, {{1.0, 0.0}}, 3);
+    mlp.save(filename);
+
+    MLP loaded({7, 6, 2}, 0.01, frelu, freluDerivative, true);
+    loaded.load(filename);
+    assert(loaded.getEmbeddings().getTable() == mlp.getEmbeddings().getTable());
+    assert(loaded.predict(sample) == mlp.predict(sample));
+
+    // The table is rounded like the other weights
+    mlp.save(filename, WeightPrecision::Bfloat16);
+    loaded.load(filename);
+    for (std::size_t i = 0; i < mlp.getEmbeddings().getTable().size(); ++i) {
+        double value = mlp.getEmbeddings().getTable()[i];
+        assert(std::abs(loaded.getEmbeddings().getTable()[i] - value) <= std::abs(value) * 0x1.0p-8);
+    }
+
+    // Checkpoints and data-parallel training go through the parameters, which include the table
+    MLP copy({7, 6, 2}, 0.01, frelu, freluDerivative, true);
+    copy.setEmbeddings({10, 5, 3}, 2);
+    copy.setParameters(mlp.getParameters());
+    assert(copy.predict(sample) == mlp.predict(sample));
+
+    // Models saved without embeddings have none when loaded
+    MLP plain({7, 6, 2}, 0.01, frelu, freluDerivative, true);
+    plain.save(filename);
+    loaded.load(filename);
+    assert(loaded.getEmbeddings().empty());
+
+    // A file that fails after its embeddings leaves the network without them
+    mlp.save(filename);
+    std::vector<char> bytes = readBytes(filename);
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - sizeof(double)));
+    }
+    bool thrown = false;
+    try {
+        loaded.load(filename);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown && loaded.getEmbeddings().empty());
+
+    std::remove(filename.c_str());
+}
+
+template <typename T> void overwrite(std::vector<char> &bytes, std::size_t offset, T value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+// Save the embeddings, corrupt the bytes of the file and load the result
+bool loadFails(const EmbeddingLayer &embeddings, WeightPrecision precision,
+               const std::function<void(std::vector<char> &)> &corrupt) {
+    std::string filename = "test_corrupted_embeddings.bin";
+    {
+        std::ofstream out(filename, std::ios::binary);
+        embeddings.save(out, precision);
+    }
+    std::vector<char> bytes;
+    {
+        std::ifstream in(filename, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    corrupt(bytes);
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    EmbeddingLayer loaded;
+    bool thrown = false;
+    try {
+        std::ifstream in(filename, std::ios::binary);
+        loaded.load(in);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    std::remove(filename.c_str());
+    return thrown;
+}
+
+void testCorruptedFiles() {
+    EmbeddingLayer embeddings({5, 3}, 4, 7);
+
+    // Layout: columns, dimension, 2 cardinalities, precision, 8 rows of 4 values
+    const std::size_t dimensionOffset = sizeof(std::size_t);
+    const std::size_t cardinalitiesOffset = dimensionOffset + sizeof(std::size_t);
+    const std::size_t tableOffset = cardinalitiesOffset + 2 * sizeof(std::size_t) + 1;
+    constexpr std::size_t maxSize = std::numeric_limits<std::size_t>::max();
+    auto set = [](std::size_t offset, auto value) {
+        return [=](std::vector<char> &bytes) { overwrite(bytes, offset, value); };
+    };
+    for (WeightPrecision precision : {WeightPrecision::Double, WeightPrecision::Bfloat16}) {
+        assert(!loadFails(embeddings, precision, [](std::vector<char> &) {}));
+        assert(loadFails(embeddings, precision, set(0, std::size_t{1} << 40)));
+        assert(loadFails(embeddings, precision, set(dimensionOffset, std::size_t{0})));
+        assert(loadFails(embeddings, precision, set(dimensionOffset, std::size_t{1} << 40)));
+        assert(loadFails(embeddings, precision, set(dimensionOffset, maxSize)));
+        assert(loadFails(embeddings, precision, set(cardinalitiesOffset, std::size_t{0})));
+        assert(loadFails(embeddings, precision, set(cardinalitiesOffset, maxSize)));
+        assert(loadFails(embeddings, precision, set(cardinalitiesOffset, std::size_t{1} << 62)));
+        assert(loadFails(embeddings, precision, [&](std::vector<char> &bytes) { bytes.resize(tableOffset + 8); }));
+    }
+}
+
+void testVersion2File() {
+    std::string filename = "test_version2_model.bin";
+    MLP mlp({3, 5, 2}, 0.01, frelu, freluDerivative);
+    mlp.fitPreprocessor({{1.0, 200.0, 0.5}, {3.0, 100.0, 0.25}, {2.0, 400.0, 0.75}},
+                        std::vector<FeatureTransform>(3, FeatureTransform::MinMax));
+    {
+        std::ofstream out(filename, std::ios::binary);
+        mlp.getPreprocessor().save(out);
+    }
+    const std::size_t embeddingsOffset = sizeof(std::uint64_t) + sizeof(std::uint32_t) + readBytes(filename).size();
+
+    // Version 2 files are version 3 files without the embedding block, which is a zero column count here
+    mlp.save(filename);
+    std::vector<char> bytes = readBytes(filename);
+    assert(bytes.size() > embeddingsOffset + sizeof(std::size_t));
+    assert(std::all_of(bytes.begin() + embeddingsOffset, bytes.begin() + embeddingsOffset + sizeof(std::size_t),
+                       [](char byte) { return byte == 0; }));
+    bytes.erase(bytes.begin() + embeddingsOffset, bytes.begin() + embeddingsOffset + sizeof(std::size_t));
+    overwrite(bytes, sizeof(std::uint64_t), std::uint32_t{2});
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    // Loading drops any embeddings the network had and keeps the preprocessor of the file
+    MLP loaded({3, 5, 2}, 0.01, frelu, freluDerivative);
+    loaded.setEmbeddings({4}, 2);
+    loaded.load(filename);
+    assert(loaded.getEmbeddings().empty());
+    assert(loaded.getPreprocessor().getScales() == mlp.getPreprocessor().getScales());
+    std::vector<double> input{2.5, 300.0, 0.5};
+    assert(loaded.predict(input) == mlp.predict(input));
+
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,76 @@
+#include "iris_model.h" // generated at build time by mlp_export from examples/iris_model.bin
+#include "mlp.h"
+#include "utils.h"
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+void testGeneratedMatchesPredict();
+void testRejectsCustomActivation();
+
+int main() {
+    try {
+        testGeneratedMatchesPredict();
+        testRejectsCustomActivation();
+
+        std::cout << "All export tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void testGeneratedMatchesPredict() {
+    // Same network structure as in examples/iris_train.cpp
+    MLP mlp(0.00001, true);
+    mlp.addLayer(4, frelu, freluDerivative);
+    mlp.addLayer(10, frelu, freluDerivative);
+    mlp.addLayer(10, frelu, freluDerivative);
+    mlp.addLayer(3, fidentity, fidentityDerivative);
+    mlp.load("iris_model.bin");
+
+    std::ifstream file("iris.csv");
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not find file: iris.csv");
+    }
+    const std::unordered_map<std::string, double> conversionRules = {
+        {"Iris-setosa", 0.0}, {"Iris-versicolor", 1.0}, {"Iris-virginica", 2.0}};
+    std::vector<std::vector<double>> dataset = parseCSV(file, 0, {}, conversionRules);
+    assert(!dataset.empty());
+
+    static_assert(iris_model::kInputs == 4 && iris_model::kOutputs == 3);
+    for (const auto &row : dataset) {
+        std::array<double, iris_model::kInputs> input{row[0], row[1], row[2], row[3]};
+        std::vector<double> expected = mlp.predict({row.begin(), row.begin() + 4});
+        std::array<double, iris_model::kOutputs> actual = iris_model::predict(input);
+        for (std::size_t i = 0; i < actual.size(); ++i) {
+            // Only FMA contraction differences are allowed, the weights are emitted with full precision
+            assert(approxEqual(actual[i], expected[i], 1e-12));
+        }
+    }
+}
+
+void testRejectsCustomActivation() {
+    MLP mlp(0.1);
+    mlp.addLayer(2, nullptr, nullptr);
+    mlp.addLayer(1, [](double x) { return 2.0 * x; }, fidentityDerivative);
+
+    std::string filename = "test_custom_model.h";
+    bool thrown = false;
+    try {
+        mlp.exportHeader(filename, "custom_model");
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::remove(filename.c_str());
+}
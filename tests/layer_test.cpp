@@ -1,21 +1,36 @@
 #include "layer.h"
 #include "utils.h"
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 void testWeightSetting();
 void testOutputCalculation();
 void testLayerConnection();
+void testPruning();
+void testCorruptedFiles();
+void testPrunedFileSize();
 
 int main() {
     try {
         testWeightSetting();
         testOutputCalculation();
         testLayerConnection();
+        testPruning();
+        testCorruptedFiles();
+        testPrunedFileSize();
 
         std::cout << "All layer tests passed successfully.\n";
         return 0;
@@ -70,3 +85,179 @@ void testLayerConnection() {
         assert((inputs == std::vector<double>{1.0, 1.0, 1.0}));
     }
 }
+
+void testPruning() {
+    Layer layer(2, 4, fidentity, fidentityDerivative);
+    layer.setAllWeights({{0.5, 0.01, -0.02, 0.8}, {-0.03, 0.04, 0.9, 0.0}});
+    assert(!layer.isPruned() && layer.getDensity() == 1.0);
+
+    // Weights below 0.1 in magnitude are dropped, the one that is already zero is not counted
+    std::size_t numPruned = layer.prune(0.1);
+    assert(numPruned == 4);
+    assert(layer.isPruned());
+    assert(approxEqual(layer.getDensity(), 3.0 / 8.0));
+    assert((layer.getNeurons()[0].getWeights() == std::vector<double>{0.5, 0.0, 0.0, 0.8}));
+
+    // The sparse kernel gives the same outputs as the dense one
+    std::vector<double> inputs{1.0, 2.0, 3.0, 4.0};
+    layer.setInputsForAllNeurons(inputs);
+    layer.calculateOutputs();
+    std::vector<double> denseOutputs = layer.getOutputs();
+    layer.calculateSparseOutputs(inputs);
+    assert(layer.getOutputs() == denseOutputs);
+
+    // Updated weights keep the pruning pattern
+    layer.getNeurons()[0].setWeights({0.6, 0.7, 0.7, 0.9});
+    layer.applyPruningMask();
+    assert((layer.getNeurons()[0].getWeights() == std::vector<double>{0.6, 0.0, 0.0, 0.9}));
+    layer.calculateSparseOutputs(inputs);
+    assert(approxEqual(layer.getOutputs()[0], 1.0 + 0.6 + 0.9 * 4.0));
+}
+
+template <typename T> void overwrite(std::vector<char> &bytes, std::size_t offset, T value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+// Save the layer, corrupt the bytes of the file and load the result into a layer of the same shape
+bool loadFails(const Layer &layer, WeightPrecision precision, const std::function<void(std::vector<char> &)> &corrupt) {
+    std::string filename = "test_corrupted_layer.bin";
+    {
+        std::ofstream out(filename, std::ios::binary);
+        layer.save(out, precision);
+    }
+    std::vector<char> bytes;
+    {
+        std::ifstream in(filename, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    corrupt(bytes);
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    Layer loaded(layer.getNeurons().size(), layer.getNeurons().front().getWeights().size(), fidentity,
+                 fidentityDerivative);
+    bool thrown = false;
+    try {
+        std::ifstream in(filename, std::ios::binary);
+        loaded.load(in);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    std::remove(filename.c_str());
+    return thrown;
+}
+
+void testCorruptedFiles() {
+    // Sparse enough to be written as compressed sparse rows
+    Layer layer(2, 16, fidentity, fidentityDerivative);
+    std::vector<std::vector<double>> weights(2, std::vector<double>(16, 0.0));
+    weights[0][0] = 0.5;
+    weights[0][15] = 0.8;
+    weights[1][9] = 0.9;
+    layer.setAllWeights(weights);
+    layer.prune(0.1);
+
+    // Sparse layout: neurons, encoding, inputs, values, 3 row starts, 3 columns, 3 values
+    const std::size_t inputsOffset = sizeof(std::size_t) + 1;
+    const std::size_t valuesOffset = inputsOffset + sizeof(std::size_t);
+    const std::size_t rowStartOffset = valuesOffset + sizeof(std::size_t);
+    const std::size_t columnsOffset = rowStartOffset + 3 * sizeof(std::size_t);
+    auto set = [](std::size_t offset, auto value) {
+        return [=](std::vector<char> &bytes) { overwrite(bytes, offset, value); };
+    };
+    assert(!loadFails(layer, WeightPrecision::Double, [](std::vector<char> &) {}));
+    assert(loadFails(layer, WeightPrecision::Double, set(inputsOffset, std::size_t{1} << 40)));
+    assert(loadFails(layer, WeightPrecision::Double, set(valuesOffset, std::size_t{1} << 40)));
+    assert(loadFails(layer, WeightPrecision::Double, set(rowStartOffset, std::size_t{1})));
+    assert(loadFails(layer, WeightPrecision::Double, set(rowStartOffset + sizeof(std::size_t), std::size_t{4})));
+    assert(loadFails(layer, WeightPrecision::Double, set(columnsOffset, std::uint32_t{16})));
+    assert(loadFails(layer, WeightPrecision::Double, set(columnsOffset, std::uint32_t{15})));
+    assert(loadFails(layer, WeightPrecision::Bfloat16, set(columnsOffset + 4, std::uint32_t{1000})));
+    assert(loadFails(layer, WeightPrecision::Double, [&](std::vector<char> &bytes) { bytes.resize(columnsOffset); }));
+
+    // Dense bfloat16 layers check the number of inputs before reading any weight
+    Layer dense(2, 4, fidentity, fidentityDerivative);
+    dense.setAllWeights({{0.5, 0.1, 0.2, 0.8}, {0.3, 0.4, 0.9, 0.6}});
+    assert(!loadFails(dense, WeightPrecision::Bfloat16, [](std::vector<char> &) {}));
+    assert(loadFails(dense, WeightPrecision::Bfloat16, set(inputsOffset, std::size_t{1} << 40)));
+
+    // So are masked layers, which also fail when truncated
+    dense.prune(0.15);
+    for (WeightPrecision precision : {WeightPrecision::Double, WeightPrecision::Bfloat16}) {
+        assert(!loadFails(dense, precision, [](std::vector<char> &) {}));
+        assert(loadFails(dense, precision, set(inputsOffset, std::size_t{1} << 40)));
+        assert(loadFails(dense, precision, [&](std::vector<char> &bytes) { bytes.resize(bytes.size() - 1); }));
+    }
+}
+
+std::size_t savedSize(const Layer &layer, WeightPrecision precision) {
+    std::string filename = "test_layer_size.bin";
+    {
+        std::ofstream out(filename, std::ios::binary);
+        layer.save(out, precision);
+    }
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    auto size = static_cast<std::size_t>(in.tellg());
+    std::remove(filename.c_str());
+    return size;
+}
+
+void testPrunedFileSize() {
+    Layer layer(32, 64, fidentity, fidentityDerivative);
+    std::vector<std::vector<double>> weights(32, std::vector<double>(64));
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        for (std::size_t w = 0; w < weights[i].size(); ++w) {
+            weights[i][w] = static_cast<double>((i * 7 + w * 3) % 4) + 0.25 * static_cast<double>(w % 5);
+        }
+    }
+    layer.setAllWeights(weights);
+    for (WeightPrecision precision : {WeightPrecision::Double, WeightPrecision::Bfloat16}) {
+        std::size_t denseSize = savedSize(layer, precision);
+        Layer lightlyPruned = layer;
+        lightlyPruned.prune(1.0);
+        assert(approxEqual(lightlyPruned.getDensity(), 0.8, 0.01));
+
+        // Light pruning never makes the file bigger than the dense one by more than the mask
+        std::size_t prunedSize = savedSize(lightlyPruned, precision);
+        assert(prunedSize <= denseSize + (32 * 64) / 8);
+
+        // Heavy pruning still gives compressed sparse rows, which are smaller than the dense weights alone
+        Layer heavilyPruned = layer;
+        heavilyPruned.prune(3.5);
+        assert(heavilyPruned.getDensity() < 0.2);
+        assert(savedSize(heavilyPruned, precision) < denseSize);
+
+        // Both keep their pruning when loaded, and pruned weights stay pruned after training
+        for (const Layer *pruned : {&lightlyPruned, &heavilyPruned}) {
+            std::string filename = "test_layer_pruned.bin";
+            {
+                std::ofstream out(filename, std::ios::binary);
+                pruned->save(out, precision);
+            }
+            Layer loaded(32, 64, fidentity, fidentityDerivative);
+            {
+                std::ifstream in(filename, std::ios::binary);
+                loaded.load(in);
+            }
+            std::remove(filename.c_str());
+            assert(loaded.isPruned() && loaded.getDensity() == pruned->getDensity());
+            for (std::size_t i = 0; i < 32; ++i) {
+                for (std::size_t w = 0; w < 64; ++w) {
+                    double expected = pruned->getNeurons()[i].getWeights()[w];
+                    double actual = loaded.getNeurons()[i].getWeights()[w];
+                    double tolerance = precision == WeightPrecision::Double ? 0.0 : std::abs(expected) * 0x1.0p-8;
+                    assert(std::abs(actual - expected) <= tolerance);
+                }
+            }
+            loaded.getNeurons()[0].setWeights(std::vector<double>(64, 1.0));
+            loaded.applyPruningMask();
+            assert(loaded.getDensity() == pruned->getDensity());
+            for (std::size_t w = 0; w < 64; ++w) {
+                bool wasPruned = pruned->getNeurons()[0].getWeights()[w] == 0.0;
+                assert((loaded.getNeurons()[0].getWeights()[w] == 0.0) == wasPruned);
+            }
+        }
+    }
+}
@@ -1,8 +1,10 @@
 #include "mlp.h"
 #include "utils.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <exception>
+#include <fstream>
 #include <ext/string_conversions.h>
 #include <iostream>
 #include <string>
@@ -10,15 +12,23 @@
 
 void testFeedForward();
 void testBackPropagate();
+void testHiddenGradients();
 void testTrainingAndPrediction();
 void testSaveAndLoad();
+void testParallelInference();
+void testPruneAndSaveSparse();
+void testSaveBfloat16();
 
 int main() {
     try {
         testTrainingAndPrediction();
         testFeedForward();
         testBackPropagate();
+        testHiddenGradients();
         testSaveAndLoad();
+        testParallelInference();
+        testPruneAndSaveSparse();
+        testSaveBfloat16();
 
         std::cout << "All MLP tests passed successfully.\n";
         return 0;
@@ -79,6 +89,80 @@ void testBackPropagate() {
     assert(std::abs(newOutputs[0] - 2.25) > 1e-5); // Expecting a change in the output
 }
 
+// Weights of every layer, in the layout taken by setWeightsAllLayers
+std::vector<std::vector<std::vector<double>>> getAllWeights(MLP &mlp) {
+    std::vector<std::vector<std::vector<double>>> weights;
+    for (auto &layer : mlp.getLayers()) {
+        weights.emplace_back();
+        for (const auto &neuron : layer.getNeurons()) {
+            weights.back().push_back(neuron.getWeights());
+        }
+    }
+    return weights;
+}
+
+double loss(MLP &mlp, const std::vector<double> &input, const std::vector<double> &target) {
+    mlp.feedForward(input);
+    std::vector<double> output = mlp.getResult();
+    double sum = 0.0;
+    for (std::size_t i = 0; i < output.size(); ++i) {
+        sum += 0.5 * (output[i] - target[i]) * (output[i] - target[i]);
+    }
+    return sum;
+}
+
+void testHiddenGradients() {
+    // A narrow hidden layer followed by a wider one, so the gradients of the first depend on weights it does not own
+    MLP mlp(0.01);
+    mlp.addLayer(3, fidentity, fidentityDerivative);
+    mlp.addLayer(3, frelu, freluDerivative);
+    mlp.addLayer(5, frelu, freluDerivative);
+    mlp.addLayer(2, fidentity, fidentityDerivative);
+    std::vector<std::vector<std::vector<double>>> weights = getAllWeights(mlp);
+    for (std::size_t l = 0; l < weights.size(); ++l) {
+        for (std::size_t n = 0; n < weights[l].size(); ++n) {
+            for (std::size_t w = 0; w < weights[l][n].size(); ++w) {
+                weights[l][n][w] = 0.1 * static_cast<double>((l * 7 + n * 3 + w * 5) % 11) - 0.3;
+            }
+        }
+    }
+    mlp.setWeightsAllLayers(weights);
+    std::vector<double> input{0.5, -0.25, 0.75};
+    // Close to the current output, so no gradient is clipped
+    std::vector<double> target = mlp.predict(input);
+    target[0] += 0.3;
+    target[1] -= 0.2;
+
+    // One backpropagation step must move every weight against the finite difference of the loss
+    std::vector<std::vector<std::vector<double>>> expected = weights;
+    for (std::size_t l = 0; l < weights.size(); ++l) {
+        for (std::size_t n = 0; n < weights[l].size(); ++n) {
+            for (std::size_t w = 0; w < weights[l][n].size(); ++w) {
+                std::vector<std::vector<std::vector<double>>> shifted = weights;
+                shifted[l][n][w] += 1e-6;
+                mlp.setWeightsAllLayers(shifted);
+                double up = loss(mlp, input, target);
+                shifted[l][n][w] -= 2e-6;
+                mlp.setWeightsAllLayers(shifted);
+                double down = loss(mlp, input, target);
+                expected[l][n][w] -= 0.01 * (up - down) / 2e-6;
+            }
+        }
+    }
+    mlp.setWeightsAllLayers(weights);
+
+    mlp.feedForward(input);
+    mlp.backPropagate(target);
+    std::vector<std::vector<std::vector<double>>> updated = getAllWeights(mlp);
+    for (std::size_t l = 0; l < weights.size(); ++l) {
+        for (std::size_t n = 0; n < weights[l].size(); ++n) {
+            for (std::size_t w = 0; w < weights[l][n].size(); ++w) {
+                assert(approxEqual(updated[l][n][w], expected[l][n][w], 1e-8));
+            }
+        }
+    }
+}
+
 void testSaveAndLoad() {
     MLP mlp1({2, 3, 1}, 0.0001, fidentity, fidentityDerivative);
     std::string filename = "test_mlp_model.bin";
@@ -117,4 +201,93 @@ void testTrainingAndPrediction() {
         std::cout << "Prediction: " << prediction[0] << ", Target: " << targets[i][0] << '\n';
         assert(std::abs(prediction[0] - targets[i][0]) < 0.5); // Assert predictions are close to targets
     }
-}
\ No newline at end of file
+}
+
+void testParallelInference() {
+    MLP serial({64, 256, 64, 4}, 0.01, ftanh, ftanhDerivative, true);
+    MLP parallel = serial;
+    parallel.setParallelism(4, 0); // split every layer regardless of its size
+
+    std::vector<double> input(64);
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        input[i] = static_cast<double>(i % 7) * 0.1 - 0.3;
+    }
+    for (std::size_t i = 0; i < 10; ++i) {
+        // Each neuron is still computed by a single thread, so results must be identical
+        assert(serial.predict(input) == parallel.predict(input));
+        input[i % input.size()] += 0.25;
+    }
+
+    // Training also goes through the parallel forward pass
+    serial.train({input}, {{0.0, 1.0, 0.0, 0.0}}, 5);
+    parallel.train({input}, {{0.0, 1.0, 0.0, 0.0}}, 5);
+    assert(serial.predict(input) == parallel.predict(input));
+}
+
+void testPruneAndSaveSparse() {
+    MLP mlp({16, 64, 64, 4}, 0.001, frelu, freluDerivative);
+    std::string denseFilename = "test_dense_model.bin";
+    std::string sparseFilename = "test_sparse_model.bin";
+    mlp.save(denseFilename);
+
+    mlp.prune(0.9, true);
+    for (std::size_t l = 1; l < mlp.getLayers().size(); ++l) {
+        assert(mlp.getLayers()[l].isSparse());
+    }
+    mlp.save(sparseFilename);
+
+    // The sparse file keeps the pruning and is much smaller than the dense one
+    std::ifstream denseFile(denseFilename, std::ios::binary | std::ios::ate);
+    std::ifstream sparseFile(sparseFilename, std::ios::binary | std::ios::ate);
+    assert(sparseFile.tellg() * 4 < denseFile.tellg());
+
+    MLP loaded({16, 64, 64, 4}, 0.001, frelu, freluDerivative);
+    loaded.load(sparseFilename);
+    std::vector<double> input(16, 0.5);
+    assert(loaded.getLayers()[1].isSparse());
+    assert(loaded.predict(input) == mlp.predict(input));
+
+    // Fine-tuning does not bring back the pruned weights
+    double density = mlp.getLayers()[2].getDensity();
+    mlp.train({input}, {{1.0, 0.0, 0.0, 0.0}}, 10);
+    assert(mlp.getLayers()[2].getDensity() == density);
+    std::size_t zeros = 0;
+    for (const auto &neuron : mlp.getLayers()[2].getNeurons()) {
+        zeros += static_cast<std::size_t>(std::ranges::count(neuron.getWeights(), 0.0));
+    }
+    assert(approxEqual(1.0 - static_cast<double>(zeros) / (64.0 * 64.0), density));
+
+    std::remove(denseFilename.c_str());
+    std::remove(sparseFilename.c_str());
+}
+
+void testSaveBfloat16() {
+    MLP mlp({32, 128, 64, 4}, 0.001, ftanh, ftanhDerivative);
+    std::string doubleFilename = "test_double_model.bin";
+    std::string bfloat16Filename = "test_bfloat16_model.bin";
+    mlp.save(doubleFilename);
+    mlp.save(bfloat16Filename, WeightPrecision::Bfloat16);
+
+    std::ifstream doubleFile(doubleFilename, std::ios::binary | std::ios::ate);
+    std::ifstream bfloat16File(bfloat16Filename, std::ios::binary | std::ios::ate);
+    assert(bfloat16File.tellg() * 4 < doubleFile.tellg());
+
+    MLP loaded({32, 128, 64, 4}, 0.001, ftanh, ftanhDerivative);
+    loaded.load(bfloat16Filename);
+    std::vector<double> input(32, 0.25);
+    std::vector<double> expected = mlp.predict(input);
+    std::vector<double> output = loaded.predict(input);
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        assert(approxEqual(output[i], expected[i], 1e-2));
+    }
+
+    // Pruned layers keep their pruning in bfloat16 files too
+    mlp.prune(0.9, true);
+    mlp.save(bfloat16Filename, WeightPrecision::Bfloat16);
+    loaded.load(bfloat16Filename);
+    assert(loaded.getLayers()[1].isSparse());
+    assert(loaded.getLayers()[1].getDensity() == mlp.getLayers()[1].getDensity());
+
+    std::remove(doubleFilename.c_str());
+    std::remove(bfloat16Filename.c_str());
+}
@@ -0,0 +1,107 @@
+#include "mlp.h"
+#include "online_learner.h"
+#include "packed_model.h"
+#include "utils.h"
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void testPublishing();
+void testMatchesTraining();
+void testConcurrentReaders();
+
+int main() {
+    try {
+        testPublishing();
+        testMatchesTraining();
+        testConcurrentReaders();
+
+        std::cout << "All online learner tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void testPublishing() {
+    MLP mlp({2, 8, 1}, 0.1, ftanh, ftanhDerivative, false, true);
+    std::vector<double> input{0.5, -0.5};
+    std::vector<double> initial = PackedModel(mlp).predict(input);
+    OnlineLearner learner(mlp, 3);
+    assert(learner.version() == 1);
+    assert(learner.predict(input) == initial);
+
+    // Updates stay invisible until the interval is reached
+    learner.update(input, {1.0});
+    learner.update(input, {1.0});
+    assert(learner.version() == 1);
+    assert(learner.predict(input) == initial);
+    learner.update(input, {1.0});
+    assert(learner.version() == 2);
+    assert(learner.predict(input)[0] > initial[0]);
+
+    // Publishing early only creates a version when there is something new
+    learner.publish();
+    assert(learner.version() == 2);
+    learner.update(input, {1.0});
+    learner.publish();
+    assert(learner.version() == 3);
+}
+
+void testMatchesTraining() {
+    std::vector<std::vector<double>> inputs{{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+    std::vector<std::vector<double>> targets{{0}, {1}, {1}, {0}};
+    MLP mlp({2, 4, 1}, 0.1, ftanh, ftanhDerivative, false, true);
+    OnlineLearner learner(mlp);
+
+    // Streaming the samples in order is the same as training for one epoch
+    learner.update(inputs, targets);
+    mlp.train(inputs, targets, 1);
+    PackedModel expected(mlp);
+    for (const auto &input : inputs) {
+        assert(learner.predict(input) == expected.predict(input));
+    }
+    assert(learner.version() == 5);
+}
+
+void testConcurrentReaders() {
+    MLP mlp({2, 32, 32, 1}, 0.05, ftanh, ftanhDerivative, false, true);
+    OnlineLearner learner(mlp);
+    std::atomic<bool> done{false};
+    std::atomic<bool> passed{true};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            std::uint64_t lastVersion = 0;
+            while (!done.load()) {
+                // A snapshot never changes, even while newer ones are being published
+                auto snapshot = learner.current();
+                std::vector<double> output = snapshot->model.predict({0.3, 0.7});
+                if (snapshot->version < lastVersion || !std::isfinite(output[0]) ||
+                    snapshot->model.predict({0.3, 0.7}) != output) {
+                    passed = false;
+                }
+                lastVersion = snapshot->version;
+            }
+        });
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        auto x = static_cast<double>(i % 10) / 10.0;
+        learner.update({x, 1.0 - x}, {x > 0.5 ? 1.0 : 0.0});
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    assert(passed);
+    assert(learner.version() == 2001);
+}
@@ -0,0 +1,154 @@
+#include "bfloat16.h"
+#include "huge_page_buffer.h"
+#include "mlp.h"
+#include "numa_topology.h"
+#include "packed_model.h"
+#include "utils.h"
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+void testHugePageBuffer();
+void testTopology();
+void testMatchesMLP();
+void testConcurrentPredict();
+void testPredictBatch();
+void testBfloat16Weights();
+
+int main() {
+    try {
+        testHugePageBuffer();
+        testTopology();
+        testMatchesMLP();
+        testConcurrentPredict();
+        testPredictBatch();
+        testBfloat16Weights();
+
+        std::cout << "All packed model tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void testHugePageBuffer() {
+    for (bool hugePages : {false, true}) {
+        HugePageBuffer buffer(300000, hugePages);
+        assert(buffer.size() == 300000);
+        assert(buffer.data()[0] == 0.0 && buffer.data()[299999] == 0.0);
+        buffer.data()[299999] = 1.5;
+
+        // Moving transfers ownership of the mapping
+        HugePageBuffer moved(std::move(buffer));
+        assert(buffer.data() == nullptr);
+        assert(moved.data()[299999] == 1.5);
+        if (!hugePages) {
+            assert(moved.backing() == PageBacking::Regular);
+        }
+    }
+}
+
+void testTopology() {
+    const NumaTopology &topology = NumaTopology::system();
+    assert(topology.numNodes() >= 1);
+    assert(topology.currentNode() < topology.numNodes());
+    for (std::size_t node = 0; node < topology.numNodes(); ++node) {
+        assert(!topology.cpusOfNode(node).empty());
+        for (unsigned cpu : topology.cpusOfNode(node)) {
+            assert(topology.nodeOfCpu(cpu) == node);
+        }
+    }
+
+    // Hosts without sysfs NUMA information are a single node
+    NumaTopology fallback("/nonexistent");
+    assert(fallback.numNodes() == 1);
+}
+
+void testMatchesMLP() {
+    MLP mlp({5, 16, 8, 3}, 0.01, ftanh, ftanhDerivative, true);
+    std::vector<double> input{0.1, 0.2, -0.3, 0.4, -0.5};
+    std::vector<double> expected = mlp.predict(input);
+
+    for (bool hugePages : {false, true}) {
+        PackedModel packed(mlp, hugePages);
+        assert(packed.numInputs() == 5 && packed.numOutputs() == 3);
+        assert(packed.numParameters() == 16 * 5 + 16 + 8 * 16 + 8 + 3 * 8 + 3);
+        assert(packed.numReplicas() == NumaTopology::system().numNodes());
+
+        std::vector<double> output = packed.predict(input);
+        assert(output.size() == expected.size());
+        for (std::size_t i = 0; i < output.size(); ++i) {
+            assert(approxEqual(output[i], expected[i], 1e-12));
+        }
+    }
+}
+
+void testConcurrentPredict() {
+    MLP mlp({4, 64, 64, 2}, 0.01, frelu, freluDerivative);
+    std::vector<double> input{1.0, -1.0, 0.5, 0.25};
+    std::vector<double> expected = mlp.predict(input);
+    PackedModel packed(mlp);
+
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(4, 0);
+    for (std::size_t t = 0; t < mismatches.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                std::vector<double> output = packed.predict(input);
+                for (std::size_t o = 0; o < output.size(); ++o) {
+                    mismatches[t] += approxEqual(output[o], expected[o], 1e-12) ? 0 : 1;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int count : mismatches) {
+        assert(count == 0);
+    }
+}
+
+void testPredictBatch() {
+    MLP mlp({3, 24, 12, 4}, 0.01, fsigmoid, fsigmoidDerivative, true);
+    PackedModel packed(mlp);
+    std::vector<std::vector<double>> batch{{0.1, 0.2, 0.3}, {-1.0, 0.0, 1.0}, {2.0, -2.0, 0.5}};
+
+    std::vector<std::vector<double>> outputs = packed.predictBatch(batch);
+    assert(outputs.size() == batch.size());
+    for (std::size_t b = 0; b < batch.size(); ++b) {
+        assert(outputs[b] == packed.predict(batch[b]));
+    }
+    assert(packed.predictBatch({}).empty());
+}
+
+void testBfloat16Weights() {
+    MLP mlp({20, 64, 32, 4}, 0.01, ftanh, ftanhDerivative, true);
+    PackedModel packed(mlp, true, true, WeightPrecision::Bfloat16);
+    assert(packed.weightPrecision() == WeightPrecision::Bfloat16);
+    assert(packed.numParameters() == 64 * 20 + 64 + 32 * 64 + 32 + 4 * 32 + 4);
+
+    std::vector<std::vector<double>> batch;
+    for (std::size_t b = 0; b < 5; ++b) {
+        std::vector<double> input(20);
+        for (std::size_t i = 0; i < input.size(); ++i) {
+            input[i] = static_cast<double>((i * 7 + b * 3) % 11) * 0.1 - 0.5;
+        }
+        batch.push_back(input);
+    }
+
+    // Rounding the weights to 8 bits of mantissa stays well within a percent of the full precision outputs
+    std::vector<std::vector<double>> outputs = packed.predictBatch(batch);
+    for (std::size_t b = 0; b < batch.size(); ++b) {
+        std::vector<double> expected = mlp.predict(batch[b]);
+        assert(outputs[b] == packed.predict(batch[b]));
+        for (std::size_t o = 0; o < expected.size(); ++o) {
+            assert(approxEqual(outputs[b][o], expected[o], 1e-2));
+        }
+    }
+}
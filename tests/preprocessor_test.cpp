@@ -0,0 +1,207 @@
+#include "mlp.h"
+#include "packed_model.h"
+#include "preprocessor.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void testStatistics();
+void testParallelFit();
+void testFolding();
+void testSaveAndLoad();
+void testScaledTraining();
+void testCorruptedFile();
+
+int main() {
+    try {
+        testStatistics();
+        testParallelFit();
+        testFolding();
+        testSaveAndLoad();
+        testScaledTraining();
+        testCorruptedFile();
+
+        std::cout << "All preprocessor tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+// Samples with features on very different scales
+std::vector<std::vector<double>> makeData(std::size_t numSamples) {
+    std::vector<std::vector<double>> data;
+    for (std::size_t i = 0; i < numSamples; ++i) {
+        auto x = static_cast<double>(i % 97);
+        data.push_back({1000.0 + 50.0 * x, 0.001 * x, std::exp(x / 10.0), 3.0});
+    }
+    return data;
+}
+
+void testStatistics() {
+    std::vector<std::vector<double>> data = makeData(500);
+    Preprocessor preprocessor;
+    assert(preprocessor.empty());
+    preprocessor.fit(data, {FeatureTransform::Standardize, FeatureTransform::MinMax, FeatureTransform::Log,
+                            FeatureTransform::Standardize});
+    assert(preprocessor.numFeatures() == 4);
+
+    std::vector<double> sum(4, 0.0);
+    std::vector<double> sumOfSquares(4, 0.0);
+    double minimum = 1.0;
+    double maximum = 0.0;
+    for (const auto &sample : preprocessor.transform(data)) {
+        for (std::size_t f = 0; f < 4; ++f) {
+            sum[f] += sample[f];
+            sumOfSquares[f] += sample[f] * sample[f];
+        }
+        minimum = std::min(minimum, sample[1]);
+        maximum = std::max(maximum, sample[1]);
+    }
+    // Standardized features have zero mean and unit variance, min-max ones span [0, 1]
+    for (std::size_t f : {0, 2}) {
+        assert(std::abs(sum[f] / 500.0) < 1e-9);
+        assert(approxEqual(sumOfSquares[f] / 500.0, 1.0));
+    }
+    assert(approxEqual(minimum, 0.0) && approxEqual(maximum, 1.0));
+    // A constant feature is only centered
+    assert(preprocessor.getScales()[3] == 1.0);
+    assert(preprocessor.transform(data.front())[3] == 0.0);
+}
+
+void testParallelFit() {
+    std::vector<std::vector<double>> data = makeData(10000);
+    std::vector<FeatureTransform> transforms(4, FeatureTransform::Standardize);
+    Preprocessor serial;
+    serial.fit(data, transforms);
+
+    // Blocks are merged in the same order whatever the number of threads
+    for (std::size_t numThreads : {2, 3, 8}) {
+        ThreadPool pool(numThreads);
+        Preprocessor parallel;
+        parallel.fit(data, transforms, &pool);
+        assert(parallel.getScales() == serial.getScales());
+        assert(parallel.getOffsets() == serial.getOffsets());
+    }
+}
+
+void testFolding() {
+    MLP mlp({4, 16, 3}, 0.01, ftanh, ftanhDerivative, true);
+    mlp.fitPreprocessor(makeData(200), {FeatureTransform::Standardize, FeatureTransform::MinMax,
+                                        FeatureTransform::Log, FeatureTransform::None});
+
+    // The packed model feeds the raw inputs to a first layer with the preprocessing folded in
+    std::vector<double> input{1234.0, 0.05, 20.0, 3.0};
+    std::vector<double> expected = mlp.predict(input);
+    PackedModel packed(mlp);
+    std::vector<double> output = packed.predict(input);
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        assert(approxEqual(output[i], expected[i], 1e-9));
+    }
+    assert(packed.predictBatch({input}).front() == output);
+}
+
+void testSaveAndLoad() {
+    std::string filename = "test_preprocessed_model.bin";
+    MLP mlp({4, 8, 2}, 0.01, frelu, freluDerivative);
+    mlp.fitPreprocessor(makeData(100), std::vector<FeatureTransform>(4, FeatureTransform::MinMax));
+    mlp.save(filename);
+
+    MLP loaded({4, 8, 2}, 0.01, frelu, freluDerivative);
+    loaded.load(filename);
+    assert(loaded.getPreprocessor().getScales() == mlp.getPreprocessor().getScales());
+    std::vector<double> input{1500.0, 0.02, 5.0, 3.0};
+    assert(loaded.predict(input) == mlp.predict(input));
+
+    // Models saved without a preprocessor take the inputs as they are
+    MLP raw({4, 8, 2}, 0.01, frelu, freluDerivative);
+    raw.save(filename);
+    loaded.load(filename);
+    assert(loaded.getPreprocessor().empty());
+
+    std::remove(filename.c_str());
+}
+
+void testScaledTraining() {
+    // The target only depends on the second feature, which is tiny next to the first one
+    std::vector<std::vector<double>> inputs = makeData(97);
+    std::vector<std::vector<double>> targets;
+    for (const auto &sample : inputs) {
+        targets.push_back({sample[1] > 0.048 ? 1.0 : 0.0});
+    }
+
+    MLP mlp({4, 8, 1}, 0.05, ftanh, ftanhDerivative, false, true);
+    mlp.fitPreprocessor(inputs, std::vector<FeatureTransform>(4, FeatureTransform::Standardize));
+    mlp.train(inputs, targets, 100);
+    std::size_t correct = 0;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        correct += static_cast<std::size_t>((mlp.predict(inputs[i])[0] > 0.5) == (targets[i][0] > 0.5));
+    }
+    assert(correct >= 90);
+}
+
+void testCorruptedFile() {
+    std::string filename = "test_corrupted_preprocessor.bin";
+    MLP mlp({4, 8, 2}, 0.01, frelu, freluDerivative);
+    mlp.fitPreprocessor(makeData(100), std::vector<FeatureTransform>(4, FeatureTransform::Standardize));
+    mlp.save(filename);
+    std::vector<char> saved;
+    {
+        std::ifstream in(filename, std::ios::binary);
+        saved.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // The feature count follows the tag and the version, counts the file cannot hold fail before any allocation
+    const std::size_t countOffset = sizeof(std::uint64_t) + sizeof(std::uint32_t);
+    for (std::size_t count : {std::size_t{1} << 40, std::numeric_limits<std::size_t>::max(), std::size_t{1} << 61}) {
+        std::vector<char> bytes = saved;
+        std::memcpy(bytes.data() + countOffset, &count, sizeof(count));
+        {
+            std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        MLP loaded({4, 8, 2}, 0.01, frelu, freluDerivative);
+        bool thrown = false;
+        try {
+            loaded.load(filename);
+        } catch (const std::runtime_error &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // A file that fails after its preprocessor leaves the network as it was
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(saved.data(), static_cast<std::streamsize>(saved.size() - sizeof(double)));
+    }
+    MLP raw({4, 8, 2}, 0.01, frelu, freluDerivative);
+    std::vector<double> input{1500.0, 0.02, 5.0, 3.0};
+    std::vector<double> expected = raw.predict(input);
+    bool thrown = false;
+    try {
+        raw.load(filename);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(raw.getPreprocessor().empty());
+    assert(raw.predict(input) == expected);
+
+    std::remove(filename.c_str());
+}
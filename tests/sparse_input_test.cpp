@@ -0,0 +1,151 @@
+#include "mlp.h"
+#include "sparse_vector.h"
+#include "utils.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void testSparseVector();
+void testPredict();
+void testTraining();
+void testPrunedAndNormalized();
+void testInvalidInputs();
+
+int main() {
+    try {
+        testSparseVector();
+        testPredict();
+        testTraining();
+        testPrunedAndNormalized();
+        testInvalidInputs();
+
+        std::cout << "All sparse input tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+// Two categorical columns of 30 and 20 categories followed by a numeric feature
+SparseVector makeSample(std::size_t i) {
+    SparseVector sample = oneHotEncodeSparse(static_cast<double>(i % 30), 30);
+    sample.append(oneHotEncodeSparse(static_cast<double>((i * 7) % 20), 20));
+    sample.append(SparseVector::fromDense({static_cast<double>(i % 5) / 4.0}));
+    return sample;
+}
+
+void testSparseVector() {
+    SparseVector oneHot = oneHotEncodeSparse(3, 6);
+    assert(oneHot.toDense() == oneHotEncode(3, 6));
+    assert(oneHot.nonZeros() == 1);
+
+    SparseVector sample = makeSample(12);
+    assert(sample.size == 51);
+    assert(sample.nonZeros() == 3);
+    std::vector<double> dense = sample.toDense();
+    assert(dense[12] == 1.0 && dense[30 + 4] == 1.0 && dense[50] == 0.5);
+    assert(SparseVector::fromDense(dense).toDense() == dense);
+}
+
+void testPredict() {
+    MLP mlp({51, 16, 3}, 0.01, frelu, freluDerivative, true);
+    for (std::size_t i = 0; i < 20; ++i) {
+        SparseVector sample = makeSample(i);
+        // Skipping the zero inputs does not change the order the other terms are added in
+        assert(mlp.predict(sample) == mlp.predict(sample.toDense()));
+    }
+}
+
+void testTraining() {
+    std::vector<SparseVector> sparseInputs;
+    std::vector<std::vector<double>> denseInputs;
+    std::vector<std::vector<double>> targets;
+    for (std::size_t i = 0; i < 60; ++i) {
+        sparseInputs.push_back(makeSample(i));
+        denseInputs.push_back(sparseInputs.back().toDense());
+        targets.push_back({i % 30 < 15 ? 1.0 : 0.0});
+    }
+
+    // The gradient of the weights of zero inputs is zero, so training on sparse inputs updates the same weights
+    MLP sparse({51, 8, 8, 1}, 0.05, ftanh, ftanhDerivative, false, true);
+    MLP dense({51, 8, 8, 1}, 0.05, ftanh, ftanhDerivative, false, true);
+    sparse.setShuffle(true);
+    dense.setShuffle(true);
+    sparse.train(sparseInputs, targets, 100);
+    dense.train(denseInputs, targets, 100);
+    assert(sparse.getParameters() == dense.getParameters());
+
+    std::size_t correct = 0;
+    for (std::size_t i = 0; i < sparseInputs.size(); ++i) {
+        correct += static_cast<std::size_t>((sparse.predict(sparseInputs[i])[0] > 0.5) == (targets[i][0] > 0.5));
+    }
+    assert(correct >= 55);
+}
+
+void testPrunedAndNormalized() {
+    MLP pruned({51, 16, 1}, 0.05, ftanh, ftanhDerivative, false, true);
+    pruned.prune(0.5, true);
+    std::vector<SparseVector> inputs{makeSample(1), makeSample(2)};
+    pruned.train(inputs, {{1.0}, {0.0}}, 5);
+    // Pruned weights stay at zero, and the kept values of the sparse kernel follow the trained weights
+    Layer &first = pruned.getLayers()[1];
+    assert(first.isPruned());
+    assert(approxEqual(first.getDensity(), 0.5, 0.01));
+    std::size_t nonzero = 0;
+    for (const auto &neuron : first.getNeurons()) {
+        nonzero += neuron.getWeights().size() - static_cast<std::size_t>(std::ranges::count(neuron.getWeights(), 0.0));
+    }
+    assert(static_cast<double>(nonzero) <= first.getDensity() * 16.0 * 51.0 + 0.5);
+    std::vector<double> dense = makeSample(1).toDense();
+    first.setInputsForAllNeurons(dense);
+    first.calculateOutputs();
+    std::vector<double> denseOutputs = first.getOutputs();
+    first.calculateSparseOutputs(dense);
+    for (std::size_t i = 0; i < denseOutputs.size(); ++i) {
+        assert(approxEqual(first.getOutputs()[i], denseOutputs[i], 1e-12));
+    }
+
+    // A normalized first layer gets the inputs expanded, with the same result as the dense path
+    MLP normalized(0.01);
+    normalized.addLayer(51, fidentity, fidentityDerivative);
+    normalized.addLayer(8, ftanh, ftanhDerivative, true, true);
+    normalized.addLayer(2, fsigmoid, fsigmoidDerivative, false, true);
+    assert(normalized.predict(makeSample(3)) == normalized.predict(makeSample(3).toDense()));
+    normalized.train(inputs, {{1.0, 0.0}, {0.0, 1.0}}, 2);
+}
+
+void testInvalidInputs() {
+    MLP mlp({51, 4, 1}, 0.01, frelu, freluDerivative);
+    bool thrown = false;
+    try {
+        mlp.predict(oneHotEncodeSparse(1, 50));
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    SparseVector outOfRange{51, {51}, {1.0}};
+    thrown = false;
+    try {
+        mlp.predict(outOfRange);
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Preprocessing would turn the zeros into other values
+    std::vector<std::vector<double>> data{makeSample(0).toDense(), makeSample(1).toDense()};
+    mlp.fitPreprocessor(data, std::vector<FeatureTransform>(51, FeatureTransform::Standardize));
+    thrown = false;
+    try {
+        mlp.predict(makeSample(0));
+    } catch (const std::logic_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
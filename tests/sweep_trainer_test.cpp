@@ -0,0 +1,91 @@
+#include "sweep_trainer.h"
+#include "utils.h"
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+void testSweep();
+void testInterleaved();
+
+int main() {
+    try {
+        testSweep();
+        testInterleaved();
+
+        std::cout << "All sweep trainer tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+// XOR with one-hot targets, used both for training and validation
+const std::vector<std::vector<double>> inputs = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+const std::vector<std::vector<double>> targets = {{1, 0}, {0, 1}, {0, 1}, {1, 0}};
+
+void testSweep() {
+    SweepTrainer trainer(inputs, targets, inputs, targets);
+    std::vector<SweepConfig> configs;
+    for (std::size_t width : {4, 8, 16}) {
+        for (double learningRate : {0.1, 0.0}) {
+            SweepConfig config;
+            config.layersNodes = {2, width, 2};
+            config.learningRate = learningRate;
+            config.activation = "tanh";
+            config.outputActivation = "sigmoid";
+            config.seed = static_cast<unsigned>(width);
+            config.epochs = 2000;
+            configs.push_back(config);
+        }
+    }
+
+    std::vector<SweepResult> results = trainer.run(configs, 3);
+    assert(results.size() == configs.size());
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        assert(results[i].configIndex == i);
+        assert(results[i].validationAccuracy >= 0.0 && results[i].validationAccuracy <= 1.0);
+    }
+
+    // A learning rate of zero never learns, so the best model must be one of the others and solve the problem
+    const MLP &best = trainer.getBestModel();
+    std::size_t bestIndex = 0;
+    for (std::size_t i = 0; i < configs.size(); ++i) {
+        if (&trainer.getModel(i) == &best) {
+            bestIndex = i;
+        }
+    }
+    assert(configs[bestIndex].learningRate > 0.0);
+    assert(results[bestIndex].validationAccuracy == 1.0);
+}
+
+void testInterleaved() {
+    // Same shape and seed, so all the models are trained together by one worker even with several threads
+    std::vector<SweepConfig> configs(3);
+    for (std::size_t i = 0; i < configs.size(); ++i) {
+        configs[i].layersNodes = {2, 8, 2};
+        configs[i].learningRate = 0.1;
+        configs[i].activation = "tanh";
+        configs[i].outputActivation = "sigmoid";
+        configs[i].seed = 7;
+    }
+    configs[0].epochs = 0; // stays untrained while the others keep going
+    configs[1].epochs = 2000;
+    configs[2].epochs = 3000;
+
+    SweepTrainer trainer(inputs, targets, inputs, targets);
+    std::vector<SweepResult> results = trainer.run(configs, 2, true);
+    assert(results[1].validationAccuracy == 1.0);
+    assert(results[2].validationAccuracy == 1.0);
+    assert(results[0].validationLoss > results[1].validationLoss);
+    assert(&trainer.getBestModel() != &trainer.getModel(0));
+
+    // Weights and sample orders only depend on the seed, so training each model on its own gives the same models
+    SweepTrainer separate(inputs, targets, inputs, targets);
+    std::vector<SweepResult> separateResults = separate.run(configs, 3);
+    for (std::size_t i = 0; i < configs.size(); ++i) {
+        assert(separateResults[i].validationLoss == results[i].validationLoss);
+    }
+}
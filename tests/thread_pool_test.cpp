@@ -0,0 +1,94 @@
+#include "thread_pool.h"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void testCoversEveryIndexOnce();
+void testBackToBackCalls();
+void testExceptionPropagation();
+void testSingleThread();
+
+int main() {
+    try {
+        testCoversEveryIndexOnce();
+        testBackToBackCalls();
+        testExceptionPropagation();
+        testSingleThread();
+
+        std::cout << "All thread pool tests passed successfully.\n";
+        return 0;
+    } catch (const std::exception &ex) {
+        std::cerr << "Test failed: " << ex.what() << '\n';
+        return 1;
+    }
+}
+
+void testCoversEveryIndexOnce() {
+    ThreadPool pool(4);
+    assert(pool.size() == 4);
+
+    // Include counts smaller than, equal to and not divisible by the number of threads
+    for (std::size_t count : {2, 3, 4, 5, 1000, 1001}) {
+        std::vector<std::atomic<int>> visits(count);
+        pool.parallelFor(count, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                visits[i].fetch_add(1);
+            }
+        });
+        for (const auto &visit : visits) {
+            assert(visit.load() == 1);
+        }
+    }
+}
+
+void testBackToBackCalls() {
+    ThreadPool pool(3);
+    std::vector<double> values(64, 1.0);
+
+    // Each call depends on the previous one, like consecutive layers in a network
+    for (int round = 0; round < 1000; ++round) {
+        pool.parallelFor(values.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                values[i] += 1.0;
+            }
+        });
+    }
+    for (double value : values) {
+        assert(value == 1001.0);
+    }
+}
+
+void testExceptionPropagation() {
+    ThreadPool pool(4);
+    bool thrown = false;
+    try {
+        pool.parallelFor(100, [](std::size_t begin, std::size_t end) {
+            if (begin <= 90 && 90 < end) {
+                throw std::runtime_error("failure in a worker");
+            }
+        });
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // The pool is still usable afterwards
+    std::atomic<std::size_t> total{0};
+    pool.parallelFor(100, [&](std::size_t begin, std::size_t end) { total.fetch_add(end - begin); });
+    assert(total.load() == 100);
+}
+
+void testSingleThread() {
+    ThreadPool pool(1);
+    assert(pool.size() == 1);
+    std::size_t calls = 0;
+    pool.parallelFor(10, [&](std::size_t begin, std::size_t end) {
+        assert(begin == 0 && end == 10);
+        ++calls;
+    });
+    assert(calls == 1);
+}
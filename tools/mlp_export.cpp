@@ -0,0 +1,44 @@
+// Command line tool to turn a model file written by MLP::save into a standalone C++ header
+//
+// Usage: mlp_export <model.bin> <output.h> <model_name> <layers> [--softmax]
+// where <layers> describes the topology used when training, e.g. "4,10:relu,10:relu,3:identity"
+// (the activation of the input layer is ignored)
+
+#include "mlp.h"
+#include "utils.h"
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+int main(int argc, char *argv[]) {
+    if (argc < 5 || argc > 6 || (argc == 6 && std::string(argv[5]) != "--softmax")) {
+        std::cerr << "Usage: " << argv[0] << " <model.bin> <output.h> <model_name> <layers> [--softmax]\n"
+                  << "  <layers> example: 4,10:relu,10:relu,3:identity\n";
+        return 1;
+    }
+
+    try {
+        MLP mlp(0.0, argc == 6);
+
+        // Recreate the architecture layer by layer from the topology description
+        std::istringstream layersStream(argv[4]);
+        std::string layerSpec;
+        while (std::getline(layersStream, layerSpec, ',')) {
+            std::size_t separator = layerSpec.find(':');
+            std::size_t numNodes = std::stoul(layerSpec.substr(0, separator));
+            std::string activation = separator == std::string::npos ? "identity" : layerSpec.substr(separator + 1);
+            auto [activationFunc, derivActivationFunc] = activationByName(activation);
+            mlp.addLayer(numNodes, activationFunc, derivActivationFunc);
+        }
+
+        mlp.load(argv[1]);
+        mlp.exportHeader(argv[2], argv[3]);
+    } catch (const std::exception &ex) {
+        std::cerr << "Export failed: " << ex.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}